@@ -15,28 +15,17 @@ DEFINES += QT_DEPRECATED_WARNINGS
 # You can also select to disable deprecated APIs only up to a certain version of Qt.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+# Links use 16 bits node indexes (up to 65534 nodes per link).
+# Uncomment the following line to use 32 bits indexes for huge nets.
+#DEFINES += GUIBLOCKS_LINK_WIDE_INDEX
+
+include(GuiBlocks/GuiBlocks.pri)
+
 SOURCES += \
-    GuiBlocks/Block.cpp \
-    GuiBlocks/Link.cpp \
-    GuiBlocks/MouseTracker.cpp \
-    GuiBlocks/Painter.cpp \
-    GuiBlocks/Scene.cpp \
-    GuiBlocks/Style.cpp \
-    GuiBlocks/Utils.cpp \
-    GuiBlocks/View.cpp \
     main.cpp \
     mainwindow.cpp
 
 HEADERS += \
-    GuiBlocks/Block.h \
-    GuiBlocks/Link.h \
-    GuiBlocks/MouseTracker.h \
-    GuiBlocks/Painter.h \
-    GuiBlocks/Scene.h \
-    GuiBlocks/Style.h \
-    GuiBlocks/TypeID.h \
-    GuiBlocks/Utils.h \
-    GuiBlocks/View.h \
     mainwindow.h
 
 FORMS += \
@@ -1,11 +1,16 @@
 #include "Block.h"
+#include "BlockAtlas.h"
+#include "BlockPrototype.h"
 #include "Link.h"
 #include <QPainter>
+#include "Scene.h"
+#include "ShadowCache.h"
+#include "TextCache.h"
 #include "Utils.h"
+#include <algorithm>
 #include <cmath>
 
 #include <QDebug>
-#include <QGraphicsDropShadowEffect>
 #include <QGraphicsSceneHoverEvent>
 #include <QGraphicsScene>
 #include <QGraphicsView>
@@ -20,66 +25,57 @@ namespace GuiBlocks {
 Block::Block(const QString &type,
              const QString &name,
              QGraphicsItem *parent)
+    : Block(BlockPrototype::get(type,{}),name,parent)
+{
+}
+
+Block::Block(std::shared_ptr<const BlockPrototype> prototype,
+             const QString &name,
+             QGraphicsItem *parent)
     : QGraphicsItem(parent),
-      _type(type),
       name(name),
-      nInputs(0),
-      nOutputs(0),
-      center(0.0,0.0),
       blockOrientation(BlockOrientation::West),
       portIndexHintToDraw(-1)
 {
     //QUuid::createUuid()
-    setCacheMode(QGraphicsItem::DeviceCoordinateCache);
+    //no item cache: in a View the body is drawn from the BlockAtlas
+    //shared by all the equal blocks
 
     //block flags:
-    setFlags(QGraphicsItem::ItemIsMovable);
+    //(the position changes are notified to the HitTester, see itemChange())
+    setFlags(QGraphicsItem::ItemIsMovable | QGraphicsItem::ItemSendsGeometryChanges);
     //setFlags(QGraphicsItem::ItemIsSelectable);
     setAcceptDrops(true);
     setAcceptHoverEvents(true);
 
-    //shadow effect:
-    setBlockEffect(StyleBlockShape::shadowColor);
-
     //block style:
     setOpacity(StyleBlockShape::opacity);
+    setPrototype(std::move(prototype));
 }
 
 Block::~Block()
 {
-
+    //the scene does not notify the items deleted while in it
+    Scene::itemDeleted(this);
 }
 
 void Block::addPort(Block::PortDir dir,QString type,QString name)
 {
-    switch( dir )
-    {
-    case PortDir::Input:
-        ports.insert(ports.begin()+nInputs++,std::make_shared<Port>(Port(this,dir,type,name)));
-        break;
-    case PortDir::Output:
-        ports.insert(ports.begin()+nInputs+nOutputs++,std::make_shared<Port>(Port(this,dir,type,name)));
-        break;
-    }
-    updateBoundingRect();
+    setPrototype(prototype->withPort({dir,type,name}));
+}
+
+const QString &Block::getType() const
+{
+    return prototype->getType();
 }
 
 void Block::setBlockOrientation(const Block::BlockOrientation &orientation)
 {
+    //the connectors and the shadow are not symmetric, so the bounding rect changes
+    prepareGeometryChange();
     blockOrientation = orientation;
-    for( const auto &port : ports )
-        if( port->isConnected() )
-        {
-            auto connPoint = mapToScene(center)+port->connectorShape.currentPosition();
-            if( port->dir == PortDir::Input )
-            {
-                if( blockOrientation == BlockOrientation::West )
-                    connPoint -= QPointF(StyleGrid::gridSize/2.0,0.0);
-                else
-                    connPoint += QPointF(StyleGrid::gridSize/2.0,0.0);
-            }
-            port->connectionLink.link->moveSelectedNode(port->connectionLink.nodeIdx,connPoint);
-        }
+    Scene::itemGeometryChanged(this);
+    moveConnectedLinks();
     update();
 }
 
@@ -91,50 +87,101 @@ void Block::toggleBlockOrientation()
         setBlockOrientation(BlockOrientation::East);
 }
 
-void Block::setCentralPosition(const QPointF &centerPos)
+void Block::layout()
 {
-    if( center == centerPos )
-        return;
+    //the ports keep their indexes, so the links stay connected
+    prototype = BlockPrototype::get(prototype->getType(),prototype->getPorts());
+    updateBoundingRect();
+    moveConnectedLinks();
+    update();
+}
 
-    center = centerPos;
-    dragArea.moveCenter(center);
-    blockRect.moveCenter(center);
+void Block::setPrototype(std::shared_ptr<const BlockPrototype> prototype)
+{
+    //the links point to the ports, which are rebuilt here
+    for( size_t i=0 ; i<nPorts ; i++ )
+        if( ports[i].isConnected() )
+            throw("setPrototype(): the ports of a connected block can not be changed.");
+    this->prototype = std::move(prototype);
+    nPorts = this->prototype->getPorts().size();
+    ports.reset(new Port[nPorts]);
+    for( size_t i=0 ; i<nPorts ; i++ )
+        ports[i] = Port(this,uint32_t(i));
+    updateBoundingRect();
 }
 
-QPointF Block::getPortConnectionPoint(const Block::Port &port)
+void Block::moveConnectedLinks()
 {
-    QPointF connectionPoint;
-    if( port.dir == Block::PortDir::Input )
+    //several ports can be connected to the same link, so the edits of the
+    //links are batched and each link updates its geometry once. The first
+    //port connected to a link opens and commits its edit (there is no
+    //container of edits, this runs on every move of a drag)
+    auto firstPortOfLink = [this](size_t i)
     {
-        if( getBlockOrientation() == Block::BlockOrientation::East )
-            connectionPoint.setX(port.connectorShape.boundingRect().width());
-        else
-            connectionPoint.setX(0);
-    }
-    else
+        if( !ports[i].isConnected() )
+            return false;
+        for( size_t j=0 ; j<i ; j++ )
+            if( ports[j].connectionLink.link == ports[i].connectionLink.link )
+                return false;
+        return true;
+    };
+    auto commitEdits = [&]
     {
-        if( getBlockOrientation() == Block::BlockOrientation::East )
-            connectionPoint.setX(0);
-        else
-            connectionPoint.setX(port.connectorShape.boundingRect().width());
+        for( size_t i=0 ; i<nPorts ; i++ )
+            if( firstPortOfLink(i) )
+                ports[i].connectionLink.link->commitEdit();
+    };
+    //the edits are committed even if a move throws, as LinkEditScope
+    struct CommitOnExit
+    {
+        decltype(commitEdits) &commit;
+        ~CommitOnExit(){ commit(); }
+    };
+
+    for( size_t i=0 ; i<nPorts ; i++ )
+        if( firstPortOfLink(i) )
+            ports[i].connectionLink.link->beginEdit();
+    CommitOnExit onExit{commitEdits};
+    for( size_t i=0 ; i<nPorts ; i++ )
+        if( ports[i].isConnected() )
+        {
+            ports[i].connectionLink.link->moveSelectedNode(ports[i].connectionLink.nodeIdx,
+                                                           mapToScene(ports[i].getConnector().anchor));
+        }
+}
+
+void Block::getConnectedLinks(std::vector<QGraphicsItem*> &links) const
+{
+    for( size_t i=0 ; i<nPorts ; i++ )
+    {
+        auto link = ports[i].connectionLink.link;
+        if( link && std::find(links.begin(),links.end(),link) == links.end() )
+            links.push_back(link);
     }
-    connectionPoint.setY(port.connectorShape.boundingRect().height()/2.0);
-    connectionPoint = port.connectorShape.boundingRect().topLeft()+mapToScene(connectionPoint.x(),connectionPoint.y());
+}
 
-    return connectionPoint;
+void Block::portConnectionChanged()
+{
+    update();
+    Scene::itemAppearanceChanged(this);
+}
+
+QPointF Block::getPortConnectionPoint(const Block::Port &port)
+{
+    return mapToScene(port.getConnector().anchor);
 }
 
 Block::Port* Block::isMouseOverPort(const QPointF &pos)
 {
-    for( size_t i=0 ; i<ports.size() ; i++ )
-        if( (*ports[i]).connectorShape.boundingRect().contains(pos) )
-            return &(*ports[i]);
-    return nullptr;
+    auto idx = prototype->pickPort(blockOrientation,pos);
+    if( idx == -1 )
+        return nullptr;
+    return &ports[size_t(idx)];
 }
 
 bool Block::isMouseOverBlock(const QPointF &pos)
 {
-    bool isOver = dragArea.contains(pos);
+    bool isOver = prototype->getDragArea().contains(pos);
     return isOver;
 }
 
@@ -157,41 +204,46 @@ void Block::paint(QPainter *painter,
     Q_UNUSED(option)
     Q_UNUSED(widget)
 
-    drawBlockShape(painter);
-    drawType(painter);
-    drawName(painter);
-    drawConnectors(painter);
+    const auto tier = StyleLevelOfDetail::tier(painter);
+    if( tier == StyleLevelOfDetail::Tier::Flat )
+    {
+        //a few pixels wide: the block is only a spot of its border color
+        //(the fill is as light as the background)
+        painter->fillRect(prototype->getDragArea(),StyleBlockShape::blockRectBorderColor);
+        return;
+    }
 
-    if( portIndexHintToDraw != -1 )
-        drawPortHint(painter,(*ports[portIndexHintToDraw]));
+    //the body in the atlas is drawn at the zoom of its bucket, drawBody()
+    //takes the tier from there. Without a widget (as in the layers of the
+    //View) the pixmaps of the atlas can not be used
+    if( atlas && widget )
+        atlas->draw(painter,
+                    prototype,
+                    blockOrientation,
+                    hover,
+                    prototype->getBodyRect(blockOrientation),
+                    [this](QPainter *bodyPainter){ drawBody(bodyPainter); });
+    else
+        drawBody(painter);
+
+    //the overlays: what is not shared with the other blocks of the prototype
+    if( tier == StyleLevelOfDetail::Tier::Full )
+        drawName(painter);
+    for( size_t i=0 ; i<nPorts ; i++ )
+        if( ports[i].isConnected() )
+            drawPortConnectorShape(painter,ports[i],true);
+    if( portIndexHintToDraw != -1 && tier == StyleLevelOfDetail::Tier::Full )
+        drawPortHint(painter,ports[portIndexHintToDraw]);
+}
+
+QRectF Block::boundingRect() const
+{
+    return blockRect.united(prototype->getBodyRect(blockOrientation));
 }
 
 QPainterPath Block::shape() const
 {
-    QPainterPath shape;
-    if( nInputs == 0 && nOutputs == 0 )
-    {
-        shape.addRect(dragArea);
-        return shape;
-    }
-    QRectF area = dragArea;
-    auto width = StyleBlockShape::connectorSizeGridSizePercent.width()*StyleGrid::gridSize;
-    if( blockOrientation == BlockOrientation::West )
-    {
-        if( nInputs != 0 )
-            area.setLeft(area.left()-width);
-        if( nOutputs != 0 )
-            area.setRight(area.right()+width);
-    }
-    else
-    {
-        if( nInputs != 0 )
-            area.setRight(area.right()+width);
-        if( nOutputs != 0 )
-            area.setLeft(area.left()-width);
-    }
-    shape.addRect(area);
-    return shape;
+    return prototype->getShape(blockOrientation);
 }
 
 void Block::mouseMoveEvent(QGraphicsSceneMouseEvent *event)
@@ -199,19 +251,7 @@ void Block::mouseMoveEvent(QGraphicsSceneMouseEvent *event)
     if( enableDrag )
     {
         QGraphicsItem::mouseMoveEvent(event);
-        for( const auto &port : ports )
-            if( port->isConnected() )
-            {
-                auto connPoint = mapToScene(center)+port->connectorShape.currentPosition();
-                if( port->dir == PortDir::Input )
-                {
-                    if( port->parent->getBlockOrientation() == BlockOrientation::West )
-                        connPoint -= QPointF(StyleGrid::gridSize/2.0,0.0);
-                    else
-                        connPoint += QPointF(StyleGrid::gridSize/2.0,0.0);
-                }
-                port->connectionLink.link->moveSelectedNode(port->connectionLink.nodeIdx,connPoint);
-            }
+        moveConnectedLinks();
     }
 }
 
@@ -240,19 +280,7 @@ void Block::mouseReleaseEvent(QGraphicsSceneMouseEvent *event)
             enableDrag = false;
             QPointF p = nextGridPosition(mapToScene(event->pos())-event->pos(),StyleGrid::gridSize);
             setPos(p);
-            for( const auto &port : ports )
-                if( port->isConnected() )
-                {
-                    auto connPoint = p+port->connectorShape.currentPosition();
-                    if( port->dir == PortDir::Input )
-                    {
-                        if( port->parent->getBlockOrientation() == BlockOrientation::West )
-                            connPoint -= QPointF(StyleGrid::gridSize/2.0,0.0);
-                        else
-                            connPoint += QPointF(StyleGrid::gridSize/2.0,0.0);
-                    }
-                    port->connectionLink.link->moveSelectedNode(port->connectionLink.nodeIdx,connPoint);
-                }
+            moveConnectedLinks();
 
         }
     }
@@ -262,30 +290,12 @@ void Block::hoverMoveEvent(QGraphicsSceneHoverEvent *event)
 {
     QGraphicsItem::hoverMoveEvent(event);
     int currentHintIndex = portIndexHintToDraw;
-    for( size_t i=0 ; i<ports.size() ; i++ )
-    {
-        if( (*ports[i]).connectorShape.boundingRect().contains(event->pos()) )
-        {
-            portIndexHintToDraw = int(i);
-            break;
-        }
-        else
-        {
-            portIndexHintToDraw = -1;
-        }
-    }
+    portIndexHintToDraw = prototype->pickPort(blockOrientation,event->pos());
     bool needsUpdate = (currentHintIndex != portIndexHintToDraw);
-    if( hover != dragArea.contains(event->pos()) )
+    if( hover != prototype->getDragArea().contains(event->pos()) )
     {
-        hover = dragArea.contains(event->pos());
-        if( hover )
-        {
-            setBlockEffect(StyleBlockShape::shadowColorOnHover);
-        }
-        else
-        {
-            setBlockEffect(StyleBlockShape::shadowColor);
-        }
+        //the shadow color depends on hover
+        hover = prototype->getDragArea().contains(event->pos());
         needsUpdate = true;
     }
     if( needsUpdate )
@@ -302,7 +312,6 @@ void Block::hoverLeaveEvent(QGraphicsSceneHoverEvent *event)
     if( hover == true )
     {
         hover = false;
-        setBlockEffect(StyleBlockShape::shadowColor);
         needsUpdate = true;
     }
 
@@ -318,75 +327,33 @@ void Block::hoverLeaveEvent(QGraphicsSceneHoverEvent *event)
         update();
 }
 
-void Block::updateBoundingRect()
+QVariant Block::itemChange(GraphicsItemChange change,const QVariant &value)
 {
-    //compute inner block width (enough space to write the "type" of the block plus some gap)
-    //This inner width will always be an even multiple of the gridSize
-    QFontMetrics fontMetrics = QFontMetrics(StyleText::blockTypeFont);
-    double innerBlockWidth = 2.0*StyleText::gapTypeToBorderGridSizePercent*fontMetrics.capHeight()
-                            + fontMetrics.horizontalAdvance(_type);
-    innerBlockWidth  = nextOddGridValue(innerBlockWidth,StyleGrid::gridSize);//+StyleGrid::gridSize;
-
-    //Compute Max width of the texts:
-    //This texts are the block "name" which will be displayed on top of the block.
-    //Below the block will be displayed the connector "name" and "type"
-    //(this one inside parentheses).
-    //This text width (maxPortTextWidth) or the inner block width (innerBlockWidth),
-    //whichever greater, will define the boundingRect width (maxBoundingWidth):
-    fontMetrics = QFontMetrics(StyleText::blockNameFont);
-    double maxPortTextWidth = fontMetrics.horizontalAdvance(name);
-    fontMetrics = QFontMetrics(StyleText::blockHintFont);
-    bool hasPortType = false;
-    bool hasPortName = false;
-    for( auto &port : ports )
+    Scene::itemChange(this,change);
+    if( change == ItemSceneHasChanged )
     {
-        if( (*port).name != "" )
-            hasPortName = true;
-        int width = fontMetrics.horizontalAdvance((*port).name);
-        maxPortTextWidth = max(width,maxPortTextWidth);
-        if( (*port).type != "" )
-        {
-            hasPortType = true;
-            width = fontMetrics.horizontalAdvance("("+(*port).type+")");
-            maxPortTextWidth = max(width,maxPortTextWidth);
-        }
+        auto scene = Scene::of(this);
+        atlas = scene ? &scene->getBlockAtlas() : nullptr;
     }
+    return QGraphicsItem::itemChange(change,value);
+}
 
-    maxPortTextWidth = nextEvenGridValue(maxPortTextWidth,StyleGrid::gridSize);
-
-    double maxBoundingWidth = 0;
-    if( nInputs!=0 || nOutputs!=0 )
-        maxBoundingWidth = max(maxPortTextWidth,innerBlockWidth + 2.0*StyleBlockShape::connectorSizeGridSizePercent.width()*StyleGrid::gridSize);
-
-    //compute text header and footer (block "name" and connectors "name" and "type"):
-    if( QFontMetrics(StyleText::blockNameFont).capHeight() > fontMetrics.capHeight() )
-        fontMetrics = QFontMetrics(StyleText::blockNameFont);
-    double headerFooterTextHeight = 0;
-    if( hasPortName || !_type.isEmpty() )
-        headerFooterTextHeight += 2.0*(fontMetrics.capHeight()*1.75+0*StyleText::gapTextToBorderGridSizePercent*StyleGrid::gridSize);
-    if( hasPortType )
-        headerFooterTextHeight += 2.0*(fontMetrics.capHeight()*1.75+0*StyleText::gapTextToBorderGridSizePercent*StyleGrid::gridSize);
-
-    //compute Max height due to the IO ports:
-    double maxConHeight = 2.0*max(nInputs,nOutputs);
-    maxConHeight = max(maxConHeight,2.0)*StyleGrid::gridSize;
-
-    //Compute the inner height: it will be defined by the heigth required by the connectors
-    //or by "type" displayed inside the block. Whichever greater will define the inner heigth:
-    fontMetrics = QFontMetrics(StyleText::blockTypeFont);
-    double innerBlockHeight = max(maxConHeight,nextEvenGridValue(fontMetrics.capHeight()*(1.0+2.0*StyleText::gapTypeToBorderGridSizePercent),StyleGrid::gridSize));
-
-    //innerBlockHeight will always be an even multiple of the gridSize,
-    //this implies that the size of the dragArea (inner block) has a heigth
-    //and width that is a even multple of the gridSize, and so the center
-    //will always be located at a exact grid location:
-
-    dragArea.setSize(QSizeF(innerBlockWidth,innerBlockHeight));
-    dragArea.moveCenter(center);
+void Block::updateBoundingRect()
+{
+    //blockRect is the bounding rect, the scene index must be notified first
+    prepareGeometryChange();
 
-    double maxBoundingHeigth = nextGridValue(innerBlockHeight+headerFooterTextHeight,StyleGrid::gridSize);
-    blockRect.setSize(QSizeF(maxBoundingWidth,maxBoundingHeigth));
-    blockRect.moveCenter(center);
+    //the block "name" is displayed on top of the block, and it can be
+    //wider than the rect of the prototype (see BlockPrototype::computeBoundingRect())
+    blockRect = prototype->getBlockRect();
+    if( nPorts != 0 )
+    {
+        double nameWidth = TextCache::metrics(StyleText::NameFont).horizontalAdvance(name);
+        nameWidth = nextEvenGridValue(nameWidth,StyleGrid::gridSize);
+        if( nameWidth > blockRect.width() )
+            blockRect = blockRect.adjusted(-(nameWidth-blockRect.width())/2.0,0.0,(nameWidth-blockRect.width())/2.0,0.0);
+    }
+    Scene::itemGeometryChanged(this);
 }
 
 void Block::drawBoundingRect(QPainter *painter)
@@ -408,10 +375,10 @@ void Block::drawType(QPainter *painter)
 
     painter->setPen(StyleText::blockTypeColor);
     painter->setFont(StyleText::blockTypeFont);
-    QFontMetrics fontMetrics = QFontMetrics(StyleText::blockTypeFont);
-    QPointF offsetPos = fontMetrics.boundingRect(_type).center();
+    auto &typeCache = prototype->getTextCache();
+    QPointF offsetPos = typeCache.text(getType(),StyleText::TypeFont).boundingRect.center();
 
-    painter->drawText(dragArea.center()-offsetPos,_type);
+    typeCache.draw(painter,prototype->getDragArea().center()-offsetPos,getType(),StyleText::TypeFont);
 
     painter->restore();
 }
@@ -422,13 +389,13 @@ void Block::drawName(QPainter *painter)
 
     painter->setPen(StyleText::blockNameColor);
     painter->setFont(StyleText::blockNameFont);
-    QFontMetrics fontMetrics = QFontMetrics(StyleText::blockNameFont);
-    QRectF boundingRectText = fontMetrics.boundingRect(name);
+    const QFontMetrics &fontMetrics = TextCache::metrics(StyleText::NameFont);
+    const QRectF &dragArea = prototype->getDragArea();
+    QRectF boundingRectText = textCache.text(name,StyleText::NameFont).boundingRect;
     QPointF offsetPos;
     offsetPos.setY(dragArea.top()-fontMetrics.capHeight()*0.75-0*StyleText::gapTextToBorderGridSizePercent*StyleGrid::gridSize);
     offsetPos.setX(dragArea.center().x()-boundingRectText.center().x());
-    boundingRectText.moveTo(offsetPos);
-    painter->drawText(offsetPos,name);
+    textCache.draw(painter,offsetPos,name,StyleText::NameFont);
 
     painter->restore();
 }
@@ -438,31 +405,44 @@ void Block::drawPortHint(QPainter *painter, const Block::Port &port)
     painter->save();
     painter->setPen(StyleText::blockHintColor);
     painter->setFont(StyleText::blockHintFont);
-    QFontMetrics fontMetrics = QFontMetrics(StyleText::blockHintFont);
-    if( !port.name.isEmpty() )
+    const QFontMetrics &fontMetrics = TextCache::metrics(StyleText::HintFont);
+    const QRectF &dragArea = prototype->getDragArea();
+    auto &hintCache = prototype->getTextCache();
+    if( !port.getName().isEmpty() )
     {
-        QRectF boundingRectText = fontMetrics.boundingRect(port.name);
+        QRectF boundingRectText = hintCache.text(port.getName(),StyleText::HintFont).boundingRect;
         QPointF offsetPos;
         offsetPos.setY(dragArea.bottom()+fontMetrics.capHeight()*1.75+0*boundingRectText.height());
         offsetPos.setX(dragArea.center().x()-boundingRectText.center().x());
-        painter->drawText(offsetPos,port.name);
+        hintCache.draw(painter,offsetPos,port.getName(),StyleText::HintFont);
     }
-    if( !port.type.isEmpty() )
+    if( !port.getType().isEmpty() )
     {
-        QString portType = "(" + port.type + ")";
-        QRectF boundingRectText = fontMetrics.boundingRect(portType);
+        QString portType = "(" + port.getType() + ")";
+        QRectF boundingRectText = hintCache.text(portType,StyleText::HintFont).boundingRect;
         QPointF offsetPos;
         offsetPos.setY(dragArea.bottom()+2.0*fontMetrics.capHeight()*1.75+0*2.0*boundingRectText.height());
         offsetPos.setX(dragArea.center().x()-boundingRectText.center().x());
-        painter->drawText(offsetPos,portType);
+        hintCache.draw(painter,offsetPos,portType,StyleText::HintFont);
     }
     painter->restore();
 }
 
+void Block::drawShadow(QPainter *painter)
+{
+    const QRectF &dragArea = prototype->getDragArea();
+    ShadowCache::drawRoundedRect(painter,
+                                 dragArea,
+                                 dragArea.width() *StyleBlockShape::roundingXWidthPercent,
+                                 dragArea.height()*StyleBlockShape::roundingYWidthPercent,
+                                 hover ? StyleBlockShape::shadowColorOnHover : StyleBlockShape::shadowColor);
+}
+
 void Block::drawBlockShape(QPainter *painter)
 {
     painter->save();
 
+    const QRectF &dragArea = prototype->getDragArea();
     QLinearGradient gradient(dragArea.width()*StyleBlockShape::customFillGradient.start().x(),
                              dragArea.height()*StyleBlockShape::customFillGradient.start().y(),
                              dragArea.width()*StyleBlockShape::customFillGradient.finalStop().x(),
@@ -483,122 +463,51 @@ void Block::drawBlockShape(QPainter *painter)
     painter->restore();
 }
 
-void Block::drawConnectors(QPainter *painter)
-{
-    for( int i=0 ; i<nInputs ; i++ )
-        drawConnector(painter,PortDir::Input,i);
-    for( int i=0 ; i<nOutputs ; i++ )
-        drawConnector(painter,PortDir::Output,i);
-}
-
-/**
-@brief Draw a connector on the current block
-
-This is the top level method that should be called to
-draw a connector on the block.
-*/
-void Block::drawConnector(QPainter *painter, Block::PortDir dir, int connectorIndex)
+void Block::drawBody(QPainter *painter)
 {
-    if( nInputs == 0 && nOutputs == 0 )
-        return;
-    if( dir == PortDir::Input )
-    {
-        if( connectorIndex >= nInputs )
-            return;
-        double offset;
-        double gap;
-        computeConnetorGapAndOffset(nInputs,gap,offset);
-        Port &port = getWeakPtr(dir,connectorIndex);
-        port.connectorShape = QPainterPath();   //resets the QPainterPath
-        if( blockOrientation == BlockOrientation::West )
-            port.connectorShape.moveTo(dragArea.left(),dragArea.top()+offset+gap*double(connectorIndex));
-        if( blockOrientation == BlockOrientation::East )
-            port.connectorShape.moveTo(dragArea.right(),dragArea.top()+offset+gap*double(connectorIndex));
-        drawPortConnectorShape(painter,port);
-    }
-    if( dir == PortDir::Output )
-    {
-        if( connectorIndex >= nOutputs )
-            return;
-        double offset;
-        double gap;
-        computeConnetorGapAndOffset(nOutputs,gap,offset);
-        Port &port = getWeakPtr(dir,connectorIndex);
-        port.connectorShape = QPainterPath();   //resets the QPainterPath
-        if( blockOrientation == BlockOrientation::West )
-            port.connectorShape.moveTo(dragArea.right(),dragArea.top()+offset+gap*double(connectorIndex));
-        if( blockOrientation == BlockOrientation::East )
-            port.connectorShape.moveTo(dragArea.left(),dragArea.top()+offset+gap*double(connectorIndex));
-        drawPortConnectorShape(painter,port);
-    }
+    drawShadow(painter);
+    drawBlockShape(painter);
+    if( StyleLevelOfDetail::tier(painter) == StyleLevelOfDetail::Tier::Full )
+        drawType(painter);
+    for( size_t i=0 ; i<nPorts ; i++ )
+        drawPortConnectorShape(painter,ports[i],false);
 }
 
-void Block::drawPortConnectorShape(QPainter *painter, Block::Port &port)
+void Block::drawPortConnectorShape(QPainter *painter, const Block::Port &port, bool connected)
 {
-    QSizeF size = StyleBlockShape::connectorSizeGridSizePercent*StyleGrid::gridSize;
-    QPointF arrowTip = port.connectorShape.currentPosition();
-    if( blockOrientation == BlockOrientation::West )
-    {
-        if( port.dir == PortDir::Output )
-        {
-            arrowTip.setX(arrowTip.x()+size.width());
-            port.connectorShape.moveTo(arrowTip);
-        }
-
-        port.connectorShape.lineTo(arrowTip.x()-size.width(),
-                                   arrowTip.y()-size.height()/2.0 );
-        if( port.isConnected() )
-            port.connectorShape.lineTo(arrowTip.x()-size.width(),
-                                       arrowTip.y()+size.height()/2.0 );
-        else
-            port.connectorShape.moveTo(arrowTip.x()-size.width(),
-                                       arrowTip.y()+size.height()/2.0 );
-        port.connectorShape.lineTo(arrowTip);
-    }
-    if( blockOrientation == BlockOrientation::East )
-    {
-        if( port.dir == PortDir::Output )
-        {
-            arrowTip.setX(arrowTip.x()-size.width());
-            port.connectorShape.moveTo(arrowTip);
-        }
-
-        port.connectorShape.lineTo(arrowTip.x()+size.width(),
-                                   arrowTip.y()+size.height()/2.0 );
-        if( port.isConnected() )
-            port.connectorShape.lineTo(arrowTip.x()+size.width(),
-                                       arrowTip.y()-size.height()/2.0 );
-        else
-            port.connectorShape.moveTo(arrowTip.x()+size.width(),
-                                       arrowTip.y()-size.height()/2.0 );
-        port.connectorShape.lineTo(arrowTip);
-    }
     painter->save();
     QColor fillColor;
     QColor borderColor;
-    if( port.dir == PortDir::Input )
+    if( port.getDir() == PortDir::Input )
     {
         borderColor = StyleBlockShape::inputConnectorBorderColor;
-        if( port.isConnected() )
+        if( connected )
             fillColor = StyleBlockShape::inputConnectorFillColor;
     }
     else
     {
         borderColor = StyleBlockShape::outputConnectorBorderColor;
-        if( port.isConnected() )
+        if( connected )
             fillColor = StyleBlockShape::outputConnectorFillColor;
     }
     painter->setPen(borderColor);
-    if( port.isConnected() )
-        painter->fillPath(port.connectorShape,fillColor);
-    painter->drawPath(port.connectorShape);
+    //a connected port is a filled arrow, otherwise only its two front sides are drawn
+    if( connected )
+    {
+        painter->setBrush(fillColor);
+        painter->drawConvexPolygon(port.getConnector().shape);
+    }
+    else
+        painter->drawPolyline(port.getConnector().shape);
     painter->restore();
 }
 
 Block::Port &Block::getWeakPtr(Block::PortDir dir, int connectorIndex)
 {
+    const int nInputs  = prototype->getInputsCount();
+    const int nOutputs = prototype->getOutputsCount();
     //handle errors
-    if( size_t(connectorIndex) >= ports.size() || connectorIndex < 0 )
+    if( size_t(connectorIndex) >= nPorts || connectorIndex < 0 )
         goto error;
     if( (dir == PortDir::Input) && (connectorIndex>nInputs) )
         goto error;
@@ -606,65 +515,25 @@ Block::Port &Block::getWeakPtr(Block::PortDir dir, int connectorIndex)
         goto error;
 
     if( dir == PortDir::Input )
-        return (*ports[connectorIndex]);
-    return (*ports[nInputs+connectorIndex]);
+        return ports[size_t(connectorIndex)];
+    return ports[size_t(nInputs+connectorIndex)];
 
     error:
     throw("getPort(): index out of range: QVector<Port> ports.");
 }
 
-void Block::computeConnetorGapAndOffset(const int &nPorts,double &gap, double &offset) const
-{
-    //  *** Algorithm ***
-    //
-    //  This algorithm equally distribute the height
-    //  of the block on every port.
-    //
-    //  if( Height/(nPorts+1) == Integer )
-    //  {
-    //      Offset = Height / (nPorts+1)
-    //      Gap    = Height / (nPorts+1)
-    //  }
-    //  else
-    //  {
-    //      Offset =  ceil( Height / nPorts / 2 )
-    //      Gap    = floor( Height / nPorts )
-    //  }
-    if( isInteger( dragArea.height()/StyleGrid::gridSize/double(nPorts+1) ) )
-    {
-        offset = dragArea.height() / double(nPorts+1);
-        gap    = offset;
-    }
-    else
-    {
-        offset = std::ceil(  dragArea.height()/StyleGrid::gridSize/double(nPorts) / 2.0 )*StyleGrid::gridSize;
-        gap    = std::floor( dragArea.height()/StyleGrid::gridSize/double(nPorts) )*StyleGrid::gridSize;
-    }
-}
-
-void Block::setBlockEffect(const QColor &color)
-{
-    auto effect = new QGraphicsDropShadowEffect;
-    //effect->boundingRectFor(dragArea);
-    effect->setOffset(2, 2);
-    effect->setBlurRadius(15);
-    effect->setColor(color);
-    setGraphicsEffect(effect);
-}
-
 std::weak_ptr<Block::Port> Block::getWeakPtr(const Port* port) const
 {
-    for( auto &p : ports )
-        if( p.get() == port )
-            return p;
+    //the ports share the ownership of the array
+    for( size_t i=0 ; i<nPorts ; i++ )
+        if( &ports[i] == port )
+            return std::shared_ptr<Port>(ports,&ports[i]);
     return {};
 }
 
-Block::Port::Port(Block *parent,Block::PortDir dir, QString type, QString name)
+Block::Port::Port(Block *parent,uint32_t index)
     : parent(parent),
-      dir(dir),
-      type(type),
-      name(name)
+      index(index)
 {
 //    connected = false;
 //    if( dir == Block::PortDir::Input )
@@ -677,7 +546,27 @@ Block::Port::Port(Block *parent,Block::PortDir dir, QString type, QString name)
 //    }
 }
 
-void Block::Port::connectPortToLink(Link *link, uint16_t nodeIdx)
+Block::PortDir Block::Port::getDir() const
+{
+    return parent->prototype->getPorts()[index].dir;
+}
+
+const QString &Block::Port::getType() const
+{
+    return parent->prototype->getPorts()[index].type;
+}
+
+const QString &Block::Port::getName() const
+{
+    return parent->prototype->getPorts()[index].name;
+}
+
+const Block::Connector &Block::Port::getConnector() const
+{
+    return parent->prototype->getConnector(parent->blockOrientation,index);
+}
+
+void Block::Port::connectPortToLink(Link *link, LinkIndex nodeIdx)
 {
     if( link != nullptr )
         link->connectLinkToPort(nodeIdx,this);
@@ -2,19 +2,24 @@
 #define GUIBLOCKS_BLOCK_H
 
 #include <QGraphicsItem>
+#include <QPolygonF>
 #include <QVector>
 #include <cstdint>
 #include <memory>
+#include <vector>
 #include <QDebug>
 #include <QFontMetrics>
-#include <QGraphicsDropShadowEffect>
+#include "GuiBlocks/LinkIndex.h"
 #include "GuiBlocks/Style.h"
+#include "GuiBlocks/TextCache.h"
 #include "GuiBlocks/TypeID.h"
 
 namespace GuiBlocks {
 
 //forward declaration of Link to avoid #include "Link.h" that will rise compile errors
 class Link;
+class BlockAtlas;
+class BlockPrototype;
 class Block : public QGraphicsItem
 {
 public: //exported types
@@ -23,26 +28,42 @@ public: //exported types
         Input,
         Output
     };
-    struct Port
+    //the part of a port shared by all the blocks of a BlockPrototype
+    struct PortSignature
     {
-        Block   *parent = nullptr;
         PortDir dir = PortDir::Input;
         QString type;
         QString name;
-        uint32_t uid;
+    };
+    //connector geometry in block coordinates (see BlockPrototype)
+    struct Connector
+    {
+        QPolygonF shape;    //back corner, arrow tip and back corner
+        QRectF    hitRect;  //area where the mouse is over the port
+        QPointF   anchor;   //position of the link node connected to the port
+    };
+    //the port of a block instance: its signature and geometry are the ones
+    //of the index-th port of the block prototype
+    struct Port
+    {
+        Block   *parent = nullptr;
+        uint32_t index  = 0;
         std::weak_ptr<Port> getCopy() const { return parent->getWeakPtr(this); }
-        QPainterPath connectorShape;
         struct
         {
-            uint16_t nodeIdx;
+            LinkIndex nodeIdx;
             Link *link = nullptr;
         } connectionLink;
         Port(){}
-        Port(Block *parent,PortDir dir,QString type,QString name="");
+        Port(Block *parent,uint32_t index);
         Block* getParent() const { return parent; }
-        void connectPortToLink(Link *link,uint16_t nodeIdx);
+        PortDir getDir() const;
+        const QString& getType() const;
+        const QString& getName() const;
+        const Connector& getConnector() const;
+        void connectPortToLink(Link *link,LinkIndex nodeIdx);
         void disconnectPortFromLink();
-        bool isConnected(){ return connectionLink.link != nullptr; }
+        bool isConnected() const { return connectionLink.link != nullptr; }
     };
     enum class BlockOrientation
     {
@@ -54,27 +75,42 @@ public: //general methods
     Block(const QString &_type,
           const QString &name,
           QGraphicsItem *parent = nullptr);
+    //the fast way to build many blocks of the same type
+    Block(std::shared_ptr<const BlockPrototype> prototype,
+          const QString &name,
+          QGraphicsItem *parent = nullptr);
     virtual ~Block() override;
-    int type() const override{return static_cast<int>(TypeID::BlockID);}
+    enum { Type = TypeID::BlockID };    //for qgraphicsitem_cast()
+    int type() const override{return Type;}
 
-    const QString& getType() const { return _type; }
+    const QString& getType() const;
     const QString& getName() const { return name; }
+    const std::shared_ptr<const BlockPrototype>& getPrototype() const { return prototype; }
 
     void addPort(PortDir dir,QString _type,QString name = "");
     void setBlockOrientation(const BlockOrientation &orientation);
     BlockOrientation getBlockOrientation()const { return blockOrientation; }
     void toggleBlockOrientation();
-    void setCentralPosition(const QPointF &centerPos);    //should be this implemented?
+    //the geometry of the connectors and the shape of the block are computed
+    //by the prototype, so paint() and the hit tests only read it. After
+    //changing the Style (and calling Style::changed()) this picks a
+    //prototype built with the new style
+    void layout();
     QPointF getPortConnectionPoint(const Port &port);
     Port* isMouseOverPort(const QPointF &pos);
     bool isMouseOverBlock(const QPointF &pos);
+    //appends the links connected to the ports that are not in links yet
+    void getConnectedLinks(std::vector<QGraphicsItem*> &links) const;
+    //a port was connected or disconnected: repaints its connector
+    void portConnectionChanged();
 
 
     //test methods:
     //void toggleConnectionPortState(int &indexPort);    //remove this, just for debug
 
     //Interface (pure virtual) methods:
-    QRectF boundingRect() const override{ return blockRect; }
+    //the shadow is drawn by the block, so it is part of the bounding rect
+    QRectF boundingRect() const override;
     void paint(QPainter *painter,
                const QStyleOptionGraphicsItem *option,
                QWidget *widget = nullptr) override;
@@ -87,39 +123,45 @@ public: //general methods
     void hoverMoveEvent(QGraphicsSceneHoverEvent *event) override;
     void hoverLeaveEvent(QGraphicsSceneHoverEvent *event) override;
 
+protected:
+    //reports the changes to the Scene (see Scene::itemChange())
+    QVariant itemChange(GraphicsItemChange change,const QVariant &value) override;
+
 private:
+    //builds the ports of prototype (the ports must not be connected)
+    void setPrototype(std::shared_ptr<const BlockPrototype> prototype);
     void updateBoundingRect();
+    //moves the nodes of the links connected to the ports to the anchors
+    void moveConnectedLinks();
     void drawBoundingRect(QPainter *painter);
     void drawType(QPainter *painter);
     void drawName(QPainter *painter);
     void drawPortHint(QPainter *painter,const Port &port);
+    void drawShadow(QPainter *painter);
     void drawBlockShape(QPainter *painter);
-    void drawConnectors(QPainter *painter);
+    //the part of the block that is equal in all the blocks of the prototype
+    void drawBody(QPainter *painter);
     //void drawShadowPlace(QPainter *painter);
 
-    void drawConnector(QPainter *painter,PortDir dir,int connectorIndex);
-    void drawPortConnectorShape(QPainter *painter,Port &port);
+    void drawPortConnectorShape(QPainter *painter,const Port &port,bool connected);
     Port& getWeakPtr(PortDir dir,int connectorIndex);
-    void computeConnetorGapAndOffset(const int &nPorts,double &gap,double &offset) const;
-    void setBlockEffect(const QColor &color);
 
     std::weak_ptr<Port> getWeakPtr(const Port *port) const;
 
 private: //ctor required
-    QString _type;
+    std::shared_ptr<const BlockPrototype> prototype;
     QString name;
     uint32_t uid;
 private://internal vars
-    QRectF blockRect;
-    QRectF dragArea;
-    std::vector<std::shared_ptr<Port>> ports;
-    int nInputs;
-    int nOutputs;
-    QPointF center;
+    QRectF blockRect;       //the one of the prototype, widened by the name
+    TextCache textCache;    //name (the type and hints are in the prototype)
+    std::shared_ptr<Port[]> ports;
+    size_t nPorts = 0;
     BlockOrientation blockOrientation;
     int portIndexHintToDraw;
     bool enableDrag = false;
     bool hover = false;
+    BlockAtlas *atlas = nullptr;    //of the Scene, looked up when the block is added to it
 };
 
 } // namespace GuiBlocks
@@ -0,0 +1,120 @@
+#include "BlockAtlas.h"
+
+#include "Style.h"
+#include <algorithm>
+#include <cmath>
+
+namespace GuiBlocks {
+
+bool BlockAtlas::Key::operator==(const Key &other) const noexcept
+{
+    return prototype   == other.prototype   && orientation == other.orientation &&
+           hover       == other.hover       && zoomBucket  == other.zoomBucket;
+}
+
+size_t BlockAtlas::KeyHash::operator()(const Key &key) const noexcept
+{
+    uint64_t hash = 1469598103934665603ull;
+    for( auto val : {uint64_t(reinterpret_cast<uintptr_t>(key.prototype)),
+                     uint64_t(key.orientation),uint64_t(key.hover),uint64_t(uint32_t(key.zoomBucket))} )
+        hash = (hash ^ val) * 1099511628211ull;
+    return size_t(hash);
+}
+
+void BlockAtlas::draw(QPainter *painter,
+                      const std::shared_ptr<const BlockPrototype> &prototype,
+                      Block::BlockOrientation orientation,
+                      bool hover,
+                      const QRectF &target,
+                      const std::function<void(QPainter*)> &render)
+{
+    if( generation != Style::generation() )
+    {
+        clear();
+        generation = Style::generation();
+    }
+    //the items are not rotated, so m11 is the zoom of the view, and the
+    //sprites are rendered in device pixels
+    const auto dpr  = painter->device()->devicePixelRatioF();
+    const auto zoom = painter->worldTransform().m11()*dpr;
+    if( zoom <= 0.0 )
+        return;
+    const auto bucket = int32_t(std::lround(std::log2(zoom)*bucketsPerOctave));
+    const Key key{prototype.get(),orientation,hover,bucket};
+
+    auto sprite = sprites.find(key);
+    if( sprite == sprites.end() )
+    {
+        const auto scale = std::exp2(double(bucket)/bucketsPerOctave);
+        const QSize size(int(std::ceil(target.width()*scale)),int(std::ceil(target.height()*scale)));
+        size_t page;
+        QRect rect;
+        if( size.isEmpty() || !allocate(size,page,rect) )
+        {
+            //too big for the atlas (huge zoom), it is drawn directly
+            render(painter);
+            return;
+        }
+        //the page is painted in logical pixels, as the view (the source
+        //rects of drawPixmap() are in device pixels)
+        pages[page].setDevicePixelRatio(dpr);
+        QPainter spritePainter(&pages[page]);
+        spritePainter.setRenderHint(QPainter::Antialiasing);
+        spritePainter.setClipRect(QRectF(rect.x()/dpr,rect.y()/dpr,rect.width()/dpr,rect.height()/dpr));
+        spritePainter.translate(QPointF(rect.topLeft())/dpr);
+        spritePainter.scale(scale/dpr,scale/dpr);
+        spritePainter.translate(-target.topLeft());
+        render(&spritePainter);
+        sprite = sprites.emplace(key,Sprite{page,rect,prototype}).first;
+    }
+    painter->save();
+    painter->setRenderHint(QPainter::SmoothPixmapTransform);
+    painter->drawPixmap(target,pages[sprite->second.page],QRectF(sprite->second.rect));
+    painter->restore();
+}
+
+void BlockAtlas::clear() noexcept
+{
+    sprites.clear();
+    pages.clear();
+    shelfX = 0;
+    shelfY = 0;
+    shelfHeight = 0;
+}
+
+size_t BlockAtlas::memoryUsage() const noexcept
+{
+    return pages.size()*size_t(pageSize)*size_t(pageSize)*4;
+}
+
+bool BlockAtlas::allocate(const QSize &size,size_t &page,QRect &rect)
+{
+    if( size.width() > pageSize || size.height() > pageSize )
+        return false;
+    if( !pages.empty() && shelfX+size.width() > pageSize )
+    {
+        //next shelf
+        shelfX = 0;
+        shelfY += shelfHeight;
+        shelfHeight = 0;
+    }
+    if( pages.empty() || shelfY+size.height() > pageSize )
+    {
+        //next page (when all of them are used, the sprites are rebuilt from
+        //scratch, which only happens after visiting many zoom levels)
+        if( pages.size() == maxPages )
+            clear();
+        pages.emplace_back(pageSize,pageSize);
+        pages.back().fill(Qt::transparent);
+        shelfX = 0;
+        shelfY = 0;
+        shelfHeight = 0;
+    }
+    page = pages.size()-1;
+    rect = QRect(shelfX,shelfY,size.width(),size.height());
+    shelfX += size.width();
+    shelfHeight = std::max(shelfHeight,size.height());
+    return true;
+}
+
+} // namespace GuiBlocks
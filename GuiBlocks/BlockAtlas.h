@@ -0,0 +1,79 @@
+#ifndef GUIBLOCKS_BLOCKATLAS_H
+#define GUIBLOCKS_BLOCKATLAS_H
+
+#include <QPainter>
+#include <QPixmap>
+#include <QRect>
+#include <QRectF>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "GuiBlocks/Block.h"
+
+namespace GuiBlocks {
+
+class BlockPrototype;
+
+//Rendered bodies of the blocks of a scene, packed in a few big pixmaps.
+//The body of a block only depends on its prototype, orientation and hover
+//state, so it is rendered once per zoom bucket (steps of a quarter of an
+//octave of the zoom times the device pixel ratio, so a HiDPI screen gets
+//sprites of its resolution) and blitted for every block equal to it. The
+//parts that change between blocks (name, connected ports, hints) are drawn
+//by the block on top of it
+class BlockAtlas
+{
+public:
+    //draws the body over target (item coordinates), rendering it with
+    //render (in item coordinates) the first time
+    void draw(QPainter *painter,
+              const std::shared_ptr<const BlockPrototype> &prototype,
+              Block::BlockOrientation orientation,
+              bool hover,
+              const QRectF &target,
+              const std::function<void(QPainter*)> &render);
+    void clear() noexcept;
+    //bytes used by the pages
+    size_t memoryUsage() const noexcept;
+
+private:
+    struct Key
+    {
+        const BlockPrototype    *prototype;
+        Block::BlockOrientation  orientation;
+        bool                     hover;
+        int32_t                  zoomBucket;
+        bool operator==(const Key &other) const noexcept;
+    };
+    struct KeyHash
+    {
+        size_t operator()(const Key &key) const noexcept;
+    };
+    struct Sprite
+    {
+        size_t page;
+        QRect  rect;
+        //keeps the prototype alive, so its address is not reused by another
+        std::shared_ptr<const BlockPrototype> prototype;
+    };
+    static constexpr int    pageSize = 1024;
+    static constexpr size_t maxPages = 8;
+    static constexpr int    bucketsPerOctave = 4;
+
+    //finds room for size in the pages (false if it does not fit in a page)
+    bool allocate(const QSize &size,size_t &page,QRect &rect);
+
+    std::vector<QPixmap> pages;
+    //the pages are filled by shelves: rows of sprites, left to right
+    int shelfX = 0;
+    int shelfY = 0;
+    int shelfHeight = 0;
+    std::unordered_map<Key,Sprite,KeyHash> sprites;
+    uint32_t generation = 0;
+};
+
+} // namespace GuiBlocks
+
+#endif // GUIBLOCKS_BLOCKATLAS_H
@@ -0,0 +1,263 @@
+#include "BlockPrototype.h"
+
+#include "ShadowCache.h"
+#include "Style.h"
+#include "Utils.h"
+#include <algorithm>
+#include <cmath>
+
+namespace GuiBlocks {
+
+uint32_t BlockPrototype::registryGeneration = 0;
+std::unordered_map<QString,std::shared_ptr<const BlockPrototype>,BlockPrototype::KeyHash> BlockPrototype::registry;
+
+BlockPrototype::BlockPrototype(const QString &type,std::vector<Block::PortSignature> ports)
+    : generation(Style::generation()),
+      type(type),
+      ports(std::move(ports))
+{
+    std::stable_partition(this->ports.begin(),this->ports.end(),
+                          [](const Block::PortSignature &port){ return port.dir == Block::PortDir::Input; });
+    for( const auto &port : this->ports )
+        if( port.dir == Block::PortDir::Input )
+            nInputs++;
+        else
+            nOutputs++;
+    computeBoundingRect();
+    computeLayout(Block::BlockOrientation::West);
+    computeLayout(Block::BlockOrientation::East);
+}
+
+std::shared_ptr<const BlockPrototype> BlockPrototype::get(const QString &type,
+                                                          const std::vector<Block::PortSignature> &ports)
+{
+    if( registryGeneration != Style::generation() )
+    {
+        //the blocks keep their prototypes until they call Block::layout()
+        registry.clear();
+        registryGeneration = Style::generation();
+    }
+    //the key is made of the type and the ports, split by characters that
+    //are not expected in them (the inputs and outputs are keyed apart, so
+    //their order is the one of the prototype)
+    QString key = type;
+    for( auto dir : {Block::PortDir::Input,Block::PortDir::Output} )
+    {
+        key += "\n";
+        for( const auto &port : ports )
+            if( port.dir == dir )
+                key += port.type+"\t"+port.name+"\v";
+    }
+    auto &entry = registry[key];
+    if( !entry )
+        entry = std::make_shared<const BlockPrototype>(type,ports);
+    return entry;
+}
+
+std::shared_ptr<const BlockPrototype> BlockPrototype::withPort(const Block::PortSignature &port) const
+{
+    if( generation == Style::generation() )
+        for( const auto &[signature,extension] : extensions )
+            if( signature.dir == port.dir && signature.type == port.type && signature.name == port.name )
+                if( auto prototype = extension.lock() )
+                    return prototype;
+    auto signatures = ports;
+    signatures.push_back(port);
+    auto prototype = get(type,signatures);
+    if( generation == Style::generation() )
+        extensions.emplace_back(port,prototype);
+    return prototype;
+}
+
+int BlockPrototype::pickPort(Block::BlockOrientation orientation,const QPointF &pos) const noexcept
+{
+    const auto &layout = layouts[layoutIdx(orientation)];
+    size_t first,last;
+    if( layout.inputsColumn.contains(pos) )
+    {
+        first = 0;
+        last  = size_t(nInputs);
+    }
+    else if( layout.outputsColumn.contains(pos) )
+    {
+        first = size_t(nInputs);
+        last  = size_t(nInputs+nOutputs);
+    }
+    else
+        return -1;
+    //the last connector starting above pos is the only one that can
+    //contain it (the gap between ports is larger than the connectors)
+    auto begin = layout.connectors.begin()+long(first);
+    auto end   = layout.connectors.begin()+long(last);
+    auto next  = std::upper_bound(begin,end,pos.y(),
+                                  [](double y,const Block::Connector &connector){ return y < connector.hitRect.top(); });
+    if( next == begin || !(next-1)->hitRect.contains(pos) )
+        return -1;
+    return int(next-1-layout.connectors.begin());
+}
+
+void BlockPrototype::computeBoundingRect()
+{
+    //compute inner block width (enough space to write the "type" of the block plus some gap)
+    //This inner width will always be an even multiple of the gridSize
+    const QFontMetrics *fontMetrics = &TextCache::metrics(StyleText::TypeFont);
+    double innerBlockWidth = 2.0*StyleText::gapTypeToBorderGridSizePercent*fontMetrics->capHeight()
+                            + textCache.text(type,StyleText::TypeFont).advance;
+    innerBlockWidth  = nextOddGridValue(innerBlockWidth,StyleGrid::gridSize);//+StyleGrid::gridSize;
+
+    //Compute Max width of the texts:
+    //Below the block will be displayed the connector "name" and "type"
+    //(this one inside parentheses).
+    //This text width (maxPortTextWidth) or the inner block width (innerBlockWidth),
+    //whichever greater, will define the boundingRect width (maxBoundingWidth).
+    //The block "name", displayed on top of the block, is not part of the
+    //prototype and is added by each block (see Block::setPrototype()):
+    double maxPortTextWidth = 0;
+    fontMetrics = &TextCache::metrics(StyleText::HintFont);
+    bool hasPortType = false;
+    bool hasPortName = false;
+    for( auto &port : ports )
+    {
+        if( port.name != "" )
+            hasPortName = true;
+        double width = textCache.text(port.name,StyleText::HintFont).advance;
+        maxPortTextWidth = max(width,maxPortTextWidth);
+        if( port.type != "" )
+        {
+            hasPortType = true;
+            width = textCache.text("("+port.type+")",StyleText::HintFont).advance;
+            maxPortTextWidth = max(width,maxPortTextWidth);
+        }
+    }
+
+    maxPortTextWidth = nextEvenGridValue(maxPortTextWidth,StyleGrid::gridSize);
+
+    double maxBoundingWidth = 0;
+    if( nInputs!=0 || nOutputs!=0 )
+        maxBoundingWidth = max(maxPortTextWidth,innerBlockWidth + 2.0*StyleBlockShape::connectorSizeGridSizePercent.width()*StyleGrid::gridSize);
+
+    //compute text header and footer (block "name" and connectors "name" and "type"):
+    if( TextCache::metrics(StyleText::NameFont).capHeight() > fontMetrics->capHeight() )
+        fontMetrics = &TextCache::metrics(StyleText::NameFont);
+    double headerFooterTextHeight = 0;
+    if( hasPortName || !type.isEmpty() )
+        headerFooterTextHeight += 2.0*(fontMetrics->capHeight()*1.75+0*StyleText::gapTextToBorderGridSizePercent*StyleGrid::gridSize);
+    if( hasPortType )
+        headerFooterTextHeight += 2.0*(fontMetrics->capHeight()*1.75+0*StyleText::gapTextToBorderGridSizePercent*StyleGrid::gridSize);
+
+    //compute Max height due to the IO ports:
+    double maxConHeight = 2.0*max(nInputs,nOutputs);
+    maxConHeight = max(maxConHeight,2.0)*StyleGrid::gridSize;
+
+    //Compute the inner height: it will be defined by the heigth required by the connectors
+    //or by "type" displayed inside the block. Whichever greater will define the inner heigth:
+    fontMetrics = &TextCache::metrics(StyleText::TypeFont);
+    double innerBlockHeight = max(maxConHeight,nextEvenGridValue(fontMetrics->capHeight()*(1.0+2.0*StyleText::gapTypeToBorderGridSizePercent),StyleGrid::gridSize));
+
+    //innerBlockHeight will always be an even multiple of the gridSize,
+    //this implies that the size of the dragArea (inner block) has a heigth
+    //and width that is a even multple of the gridSize, and so the center
+    //will always be located at a exact grid location:
+
+    dragArea.setSize(QSizeF(innerBlockWidth,innerBlockHeight));
+    dragArea.moveCenter(QPointF(0.0,0.0));
+
+    double maxBoundingHeigth = nextGridValue(innerBlockHeight+headerFooterTextHeight,StyleGrid::gridSize);
+    blockRect.setSize(QSizeF(maxBoundingWidth,maxBoundingHeigth));
+    blockRect.moveCenter(QPointF(0.0,0.0));
+}
+
+void BlockPrototype::computeLayout(Block::BlockOrientation orientation)
+{
+    //the inputs are placed along one side of the drag area and the outputs
+    //along the other one, and all the arrows point in the direction of the
+    //flow (to the right in West orientation)
+    auto &layout = layouts[layoutIdx(orientation)];
+    const QSizeF size = StyleBlockShape::connectorSizeGridSizePercent*StyleGrid::gridSize;
+    const double flow = (orientation == Block::BlockOrientation::West) ? 1.0 : -1.0;
+    const double inputSide  = (orientation == Block::BlockOrientation::West) ? dragArea.left()  : dragArea.right();
+    const double outputSide = (orientation == Block::BlockOrientation::West) ? dragArea.right() : dragArea.left();
+    auto placeConnector = [&](Block::PortDir dir,double side,double y)
+    {
+        //the inputs have the tip on the side, the outputs have the back
+        QPointF arrowTip(side,y);
+        if( dir == Block::PortDir::Output )
+            arrowTip.setX(side+flow*size.width());
+        const double back = arrowTip.x()-flow*size.width();
+        Block::Connector connector;
+        connector.shape = QPolygonF({QPointF(back,arrowTip.y()-flow*size.height()/2.0),
+                                     arrowTip,
+                                     QPointF(back,arrowTip.y()+flow*size.height()/2.0)});
+        connector.hitRect = connector.shape.boundingRect();
+        //the link of an input ends half a grid before the tip
+        connector.anchor = arrowTip;
+        if( dir == Block::PortDir::Input )
+            connector.anchor.setX(arrowTip.x()-flow*StyleGrid::gridSize/2.0);
+        layout.connectors.push_back(connector);
+    };
+    layout.connectors.reserve(ports.size());
+    double offset;
+    double gap;
+    computeConnetorGapAndOffset(nInputs,gap,offset);
+    for( int i=0 ; i<nInputs ; i++ )
+        placeConnector(Block::PortDir::Input,inputSide,dragArea.top()+offset+gap*double(i));
+    computeConnetorGapAndOffset(nOutputs,gap,offset);
+    for( int i=0 ; i<nOutputs ; i++ )
+        placeConnector(Block::PortDir::Output,outputSide,dragArea.top()+offset+gap*double(i));
+    for( int i=0 ; i<nInputs+nOutputs ; i++ )
+    {
+        auto &column = (i < nInputs) ? layout.inputsColumn : layout.outputsColumn;
+        column = column.isNull() ? layout.connectors[size_t(i)].hitRect : column.united(layout.connectors[size_t(i)].hitRect);
+    }
+
+    //the shape is the drag area extended over the connectors
+    QRectF area = dragArea;
+    if( nInputs != 0 )
+    {
+        if( orientation == Block::BlockOrientation::West )
+            area.setLeft(area.left()-size.width());
+        else
+            area.setRight(area.right()+size.width());
+    }
+    if( nOutputs != 0 )
+    {
+        if( orientation == Block::BlockOrientation::West )
+            area.setRight(area.right()+size.width());
+        else
+            area.setLeft(area.left()-size.width());
+    }
+    layout.shape.addRect(area);
+    //the pens are up to 2 units wide (the block border on hover)
+    layout.bodyRect = area.united(ShadowCache::shadowRect(dragArea)).adjusted(-2.0,-2.0,2.0,2.0);
+}
+
+void BlockPrototype::computeConnetorGapAndOffset(const int &nPorts,double &gap, double &offset) const
+{
+    //  *** Algorithm ***
+    //
+    //  This algorithm equally distribute the height
+    //  of the block on every port.
+    //
+    //  if( Height/(nPorts+1) == Integer )
+    //  {
+    //      Offset = Height / (nPorts+1)
+    //      Gap    = Height / (nPorts+1)
+    //  }
+    //  else
+    //  {
+    //      Offset =  ceil( Height / nPorts / 2 )
+    //      Gap    = floor( Height / nPorts )
+    //  }
+    if( isInteger( dragArea.height()/StyleGrid::gridSize/double(nPorts+1) ) )
+    {
+        offset = dragArea.height() / double(nPorts+1);
+        gap    = offset;
+    }
+    else
+    {
+        offset = std::ceil(  dragArea.height()/StyleGrid::gridSize/double(nPorts) / 2.0 )*StyleGrid::gridSize;
+        gap    = std::floor( dragArea.height()/StyleGrid::gridSize/double(nPorts) )*StyleGrid::gridSize;
+    }
+}
+
+} // namespace GuiBlocks
@@ -0,0 +1,95 @@
+#ifndef GUIBLOCKS_BLOCKPROTOTYPE_H
+#define GUIBLOCKS_BLOCKPROTOTYPE_H
+
+#include <QPainterPath>
+#include <QRectF>
+#include <QString>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "GuiBlocks/Block.h"
+#include "GuiBlocks/TextCache.h"
+
+namespace GuiBlocks {
+
+//Everything that is equal in all the blocks of the same type and ports:
+//the port signatures, the geometry (centered at the block origin, for both
+//orientations) and the laid out type and port hint texts.
+//The prototypes are immutable and shared by the blocks through get(), which
+//returns the registered one (the registry keeps them until clear()).
+//The geometry follows the Style at the time the prototype was built, after
+//Style::changed() get() builds new ones (see Block::layout())
+class BlockPrototype
+{
+public:
+    BlockPrototype(const QString &type,std::vector<Block::PortSignature> ports);
+
+    //the prototype of type with ports (the inputs are placed before the
+    //outputs, keeping their order)
+    static std::shared_ptr<const BlockPrototype> get(const QString &type,
+                                                     const std::vector<Block::PortSignature> &ports);
+    static void clear() noexcept{ registry.clear(); }
+    //the prototype with one more port (as Block::addPort())
+    std::shared_ptr<const BlockPrototype> withPort(const Block::PortSignature &port) const;
+
+    const QString& getType() const { return type; }
+    const std::vector<Block::PortSignature>& getPorts() const { return ports; }
+    int getInputsCount() const { return nInputs; }
+    int getOutputsCount() const { return nOutputs; }
+    const QRectF& getBlockRect() const { return blockRect; }
+    const QRectF& getDragArea() const { return dragArea; }
+    const Block::Connector& getConnector(Block::BlockOrientation orientation,size_t portIdx) const
+    { return layouts[layoutIdx(orientation)].connectors[portIdx]; }
+    const QPainterPath& getShape(Block::BlockOrientation orientation) const
+    { return layouts[layoutIdx(orientation)].shape; }
+    //index of the port whose hit rect contains pos, or -1 (the connectors
+    //of each column are sorted by y, so it is a binary search)
+    int pickPort(Block::BlockOrientation orientation,const QPointF &pos) const noexcept;
+    //area drawn by Block::drawBody() (shadow, block and connectors)
+    const QRectF& getBodyRect(Block::BlockOrientation orientation) const
+    { return layouts[layoutIdx(orientation)].bodyRect; }
+    //type and port hints (the lookups fill it, so it is not const)
+    TextCache& getTextCache() const { return textCache; }
+
+private:
+    struct Layout
+    {
+        std::vector<Block::Connector> connectors;
+        //united hit rects of the inputs and of the outputs
+        QRectF inputsColumn;
+        QRectF outputsColumn;
+        QPainterPath shape;
+        QRectF bodyRect;
+    };
+    struct KeyHash
+    {
+        size_t operator()(const QString &key) const noexcept{ return size_t(qHash(key)); }
+    };
+
+    static size_t layoutIdx(Block::BlockOrientation orientation) noexcept
+    { return orientation == Block::BlockOrientation::West ? 0 : 1; }
+    void computeBoundingRect();
+    void computeLayout(Block::BlockOrientation orientation);
+    void computeConnetorGapAndOffset(const int &nPorts,double &gap,double &offset) const;
+
+    uint32_t generation;
+    QString type;
+    std::vector<Block::PortSignature> ports;
+    int nInputs  = 0;
+    int nOutputs = 0;
+    QRectF blockRect;
+    QRectF dragArea;
+    Layout layouts[2];
+    mutable TextCache textCache;
+    //the prototypes returned by withPort(), so the blocks built port by
+    //port do not go through the registry on every port
+    mutable std::vector<std::pair<Block::PortSignature,std::weak_ptr<const BlockPrototype>>> extensions;
+
+    static uint32_t registryGeneration;
+    static std::unordered_map<QString,std::shared_ptr<const BlockPrototype>,KeyHash> registry;
+};
+
+} // namespace GuiBlocks
+
+#endif // GUIBLOCKS_BLOCKPROTOTYPE_H
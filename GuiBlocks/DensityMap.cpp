@@ -0,0 +1,202 @@
+#include "DensityMap.h"
+
+#include "Link.h"
+#include "Style.h"
+#include <algorithm>
+#include <cmath>
+
+namespace GuiBlocks {
+
+void DensityMap::insert(QGraphicsItem *item)
+{
+    if( item->type() == TypeID::BlockID )
+    {
+        const auto pos = cellAt(item->pos());
+        blockCells[item] = pos;
+        addBlocks(pos,1);
+    }
+    else if( item->type() == TypeID::LinkID )
+    {
+        //counted in no cell until the next draw
+        linksCells[item];
+        dirtyLinks.insert(item);
+    }
+}
+
+void DensityMap::remove(const QGraphicsItem *item)
+{
+    if( auto block = blockCells.find(item); block != blockCells.end() )
+    {
+        addBlocks(block->second,-1);
+        blockCells.erase(block);
+    }
+    else if( auto link = linksCells.find(item); link != linksCells.end() )
+    {
+        addLinks(link->second,-1);
+        linksCells.erase(link);
+        dirtyLinks.erase(const_cast<QGraphicsItem*>(item));
+    }
+}
+
+void DensityMap::update(QGraphicsItem *item)
+{
+    if( auto block = blockCells.find(item); block != blockCells.end() )
+    {
+        const auto pos = cellAt(item->pos());
+        if( pos == block->second )
+            return;
+        addBlocks(block->second,-1);
+        addBlocks(pos,1);
+        block->second = pos;
+    }
+    else if( linksCells.count(item) != 0 )
+        dirtyLinks.insert(item);
+}
+
+void DensityMap::clear() noexcept
+{
+    for( auto &level : cells )
+        level.clear();
+    blockCells.clear();
+    linksCells.clear();
+    dirtyLinks.clear();
+}
+
+void DensityMap::draw(QPainter *painter,const QRectF &rect)
+{
+    countLinks();
+
+    //the view is not rotated, so m11 is its zoom
+    const double zoom = painter->worldTransform().m11();
+    int level = 0;
+    while( level < levels-1 && cellSize(level)*zoom < StyleLevelOfDetail::overviewTilePixels )
+        level++;
+    const double size = cellSize(level);
+    const auto left   = int32_t(std::floor(rect.left()/size));
+    const auto right  = int32_t(std::floor(rect.right()/size));
+    const auto top    = int32_t(std::floor(rect.top()/size));
+    const auto bottom = int32_t(std::floor(rect.bottom()/size));
+
+    //the more items, the more opaque (it saturates at 32 per tile)
+    auto heat = [](QColor color,uint32_t count)
+    {
+        color.setAlphaF(std::min(1.0,0.25+0.15*std::log2(double(count))));
+        return color;
+    };
+    auto drawTile = [&](int32_t x,int32_t y,const Cell &cell)
+    {
+        const QRectF tile(x*size,y*size,size,size);
+        if( cell.links != 0 )
+            painter->fillRect(tile,heat(StyleLink::normalColor,cell.links));
+        if( cell.blocks != 0 )
+            painter->fillRect(tile,heat(StyleBlockShape::blockRectBorderColor,cell.blocks));
+    };
+
+    //whichever is smaller: the visible tiles or the tiles with items
+    const auto &tiles = cells[level];
+    const auto visible = int64_t(right-left+1)*int64_t(bottom-top+1);
+    if( visible > int64_t(tiles.size()) )
+    {
+        for( const auto &[key,cell] : tiles )
+        {
+            const auto x = int32_t(uint32_t(key >> 32));
+            const auto y = int32_t(uint32_t(key));
+            if( x >= left && x <= right && y >= top && y <= bottom )
+                drawTile(x,y,cell);
+        }
+        return;
+    }
+    for( auto x=left ; x<=right ; x++ )
+        for( auto y=top ; y<=bottom ; y++ )
+            if( auto cell = tiles.find(cellKey(x,y)); cell != tiles.end() )
+                drawTile(x,y,cell->second);
+}
+
+double DensityMap::cellSize(int level) noexcept
+{
+    //the cells of the first level are the ones of the coarse grid
+    return StyleGrid::gridSize*double(StyleGrid::coarseGridFactor)*double(1 << level);
+}
+
+uint64_t DensityMap::cellKey(int32_t x,int32_t y) noexcept
+{
+    return (uint64_t(uint32_t(x)) << 32) | uint64_t(uint32_t(y));
+}
+
+DensityMap::CellPos DensityMap::cellAt(const QPointF &pos) noexcept
+{
+    const double size = cellSize(0);
+    return {int32_t(std::floor(pos.x()/size)),int32_t(std::floor(pos.y()/size))};
+}
+
+void DensityMap::addBlocks(CellPos pos,int32_t blocks)
+{
+    //the shifts round towards minus infinity (arithmetic shift), as the
+    //cells of the first level
+    for( int level=0 ; level<levels ; level++ )
+        addToCell(level,cellKey(pos.x >> level,pos.y >> level),blocks,0);
+}
+
+void DensityMap::addLinks(const std::vector<CellPos> &crossed,int32_t links)
+{
+    for( int level=0 ; level<levels ; level++ )
+    {
+        levelKeys.clear();
+        for( auto pos : crossed )
+            levelKeys.push_back(cellKey(pos.x >> level,pos.y >> level));
+        std::sort(levelKeys.begin(),levelKeys.end());
+        levelKeys.erase(std::unique(levelKeys.begin(),levelKeys.end()),levelKeys.end());
+        for( auto key : levelKeys )
+            addToCell(level,key,0,links);
+    }
+}
+
+void DensityMap::addToCell(int level,uint64_t key,int32_t blocks,int32_t links)
+{
+    auto &cell = cells[level][key];
+    cell.blocks = uint32_t(int64_t(cell.blocks)+blocks);
+    cell.links  = uint32_t(int64_t(cell.links)+links);
+    if( cell.blocks == 0 && cell.links == 0 )
+        cells[level].erase(key);
+}
+
+void DensityMap::countLinks()
+{
+    for( auto item : dirtyLinks )
+    {
+        auto &counted = linksCells[item];
+        //most of the edits of a link stay in the same cells
+        auto &crossed = scratch;
+        linkCells(item,crossed);
+        if( crossed == counted )
+            continue;
+        addLinks(counted,-1);
+        addLinks(crossed,1);
+        counted.swap(crossed);
+    }
+    dirtyLinks.clear();
+}
+
+void DensityMap::linkCells(QGraphicsItem *link,std::vector<CellPos> &crossed)
+{
+    crossed.clear();
+    //the lines are sampled every half cell (a diagonal line can miss the
+    //corner of a cell, which does not matter in a heat map)
+    const double step = cellSize(0)/2.0;
+    for( const auto &line : static_cast<Link*>(link)->getLines() )
+    {
+        const int samples = int(std::ceil(line.length()/step));
+        for( int i=0 ; i<=samples ; i++ )
+        {
+            const auto pos = cellAt(samples == 0 ? line.p1() : line.pointAt(double(i)/samples));
+            if( crossed.empty() || !(crossed.back() == pos) )
+                crossed.push_back(pos);
+        }
+    }
+    //a link counts once per cell
+    auto less = [](const CellPos &a,const CellPos &b){ return a.x < b.x || (a.x == b.x && a.y < b.y); };
+    std::sort(crossed.begin(),crossed.end(),less);
+    crossed.erase(std::unique(crossed.begin(),crossed.end()),crossed.end());
+}
+
+} // namespace GuiBlocks
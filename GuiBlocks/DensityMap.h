@@ -0,0 +1,80 @@
+#ifndef GUIBLOCKS_DENSITYMAP_H
+#define GUIBLOCKS_DENSITYMAP_H
+
+#include <QGraphicsItem>
+#include <QPainter>
+#include <QRectF>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace GuiBlocks {
+
+//Number of blocks and links per cell of the scene, drawn by the View as a
+//heat map instead of the items when it is zoomed out below
+//StyleLevelOfDetail::overviewBelow (see View::paintEvent()).
+//The counts are kept in a pyramid of cell sizes (each level doubles the
+//cell of the previous one) and are updated when the items move or change
+//(see Scene::itemChange()), so drawing it only visits the tiles of the
+//level whose cells are at least StyleLevelOfDetail::overviewTilePixels wide.
+//The blocks are counted right away. The links are only marked, and their
+//lines are sampled when the map is drawn: the drags change them on every
+//move, while the overview is seldom on screen
+class DensityMap
+{
+public:
+    void insert(QGraphicsItem *item);
+    void remove(const QGraphicsItem *item);
+    //the position or the lines of item changed
+    void update(QGraphicsItem *item);
+    void clear() noexcept;
+
+    //draws the tiles over rect (scene coordinates), after counting the
+    //links changed since the last draw
+    void draw(QPainter *painter,const QRectF &rect);
+
+private:
+    struct CellPos
+    {
+        int32_t x;
+        int32_t y;
+        bool operator==(const CellPos &other) const noexcept{ return x == other.x && y == other.y; }
+    };
+    struct Cell
+    {
+        uint32_t blocks = 0;
+        uint32_t links  = 0;   //links crossing the cell
+    };
+
+    static constexpr int levels = 10;
+
+    static double cellSize(int level) noexcept;
+    static uint64_t cellKey(int32_t x,int32_t y) noexcept;
+    static CellPos cellAt(const QPointF &pos) noexcept;
+    //adds blocks to the cell of the first level at pos, and to the cells
+    //containing it in the other levels
+    void addBlocks(CellPos pos,int32_t blocks);
+    //adds links to each cell containing one of crossed, once per cell of
+    //each level (several crossed cells share the cells of the upper levels)
+    void addLinks(const std::vector<CellPos> &crossed,int32_t links);
+    void addToCell(int level,uint64_t key,int32_t blocks,int32_t links);
+    //the cells of the first level crossed by the lines of link
+    static void linkCells(QGraphicsItem *link,std::vector<CellPos> &crossed);
+    //moves the dirty links to the cells they cross now
+    void countLinks();
+
+    std::unordered_map<uint64_t,Cell> cells[levels];
+    //what each item added, to take it away when it changes
+    std::unordered_map<const QGraphicsItem*,CellPos>              blockCells;
+    std::unordered_map<const QGraphicsItem*,std::vector<CellPos>> linksCells;
+    //the links whose lines changed since they were counted
+    std::unordered_set<QGraphicsItem*> dirtyLinks;
+    //kept to reuse the storage in countLinks() and addLinks()
+    std::vector<CellPos>  scratch;
+    std::vector<uint64_t> levelKeys;
+};
+
+} // namespace GuiBlocks
+
+#endif // GUIBLOCKS_DENSITYMAP_H
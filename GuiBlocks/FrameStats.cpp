@@ -0,0 +1,20 @@
+#include "FrameStats.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace GuiBlocks {
+
+double FrameStats::percentile(double fraction) const
+{
+    if( frames.empty() )
+        return 0.0;
+    sorted = frames;
+    //nearest rank
+    const auto n = double(sorted.size());
+    const auto rank = size_t(std::clamp(std::ceil(fraction*n)-1.0,0.0,n-1.0));
+    std::nth_element(sorted.begin(),sorted.begin()+long(rank),sorted.end());
+    return sorted[rank];
+}
+
+} // namespace GuiBlocks
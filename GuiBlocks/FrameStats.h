@@ -0,0 +1,28 @@
+#ifndef GUIBLOCKS_FRAMESTATS_H
+#define GUIBLOCKS_FRAMESTATS_H
+
+#include <cstddef>
+#include <vector>
+
+namespace GuiBlocks {
+
+//Paint times of a sequence of frames (as the ones of a drag), to report
+//their median and tail
+class FrameStats
+{
+public:
+    void add(double ms) { frames.push_back(ms); }
+    void clear() noexcept { frames.clear(); }
+    size_t count() const noexcept { return frames.size(); }
+    //the time below which are the given fraction of the frames (0.5 is
+    //the median), or 0 without frames
+    double percentile(double fraction) const;
+
+private:
+    std::vector<double> frames;
+    mutable std::vector<double> sorted;
+};
+
+} // namespace GuiBlocks
+
+#endif // GUIBLOCKS_FRAMESTATS_H
@@ -0,0 +1,35 @@
+#include "GridPoint.h"
+
+#include <algorithm>
+#include <cmath>
+#include "GuiBlocks/Style.h"
+
+namespace GuiBlocks {
+
+namespace {
+
+int32_t toUnits(double val) noexcept
+{
+    const auto units = std::round(val*GridPoint::subdivisions/StyleGrid::gridSize);
+    return int32_t(std::clamp(units,-double(GridPoint::maxCoordinate),double(GridPoint::maxCoordinate)));
+}
+
+} // namespace
+
+GridPoint GridPoint::fromScene(const QPointF &point) noexcept
+{
+    return GridPoint(toUnits(point.x()),toUnits(point.y()));
+}
+
+QPointF GridPoint::toScene() const noexcept
+{
+    const auto scale = StyleGrid::gridSize/subdivisions;
+    return QPointF(x*scale,y*scale);
+}
+
+int64_t GridPoint::cross(const GridPoint &a,const GridPoint &b,const GridPoint &c) noexcept
+{
+    return int64_t(b.x-a.x)*int64_t(c.y-a.y)-int64_t(b.y-a.y)*int64_t(c.x-a.x);
+}
+
+} // namespace GuiBlocks
@@ -0,0 +1,45 @@
+#ifndef GUIBLOCKS_GRIDPOINT_H
+#define GUIBLOCKS_GRIDPOINT_H
+
+#include <QPointF>
+#include <cstdint>
+
+namespace GuiBlocks {
+
+//Point in fixed point grid units, used to store the geometry of the links.
+//A grid cell (StyleGrid::gridSize) is divided in subdivisions units, so the
+//snapped points (and the half grid connection points of the ports) are exact,
+//and the points moved freely (while dragging a block) are rounded to
+//1/subdivisions of the grid.
+//The coordinates are clamped to +/-maxCoordinate, this keeps the products
+//of two coordinate differences below 2^52, so the collinearity tests are
+//exact in int64 and also in double (see SegmentKernel).
+struct GridPoint
+{
+    static constexpr int32_t subdivisions  = 256;
+    static constexpr int32_t maxCoordinate = 1 << 25;
+
+    int32_t x = 0;
+    int32_t y = 0;
+
+    GridPoint() noexcept {}
+    GridPoint(int32_t x,int32_t y) noexcept : x(x),y(y) {}
+
+    //scene <-> grid units conversions (scale given by StyleGrid::gridSize)
+    static GridPoint fromScene(const QPointF &point) noexcept;
+    QPointF toScene() const noexcept;
+    //the point in grid units as a QPointF (no conversion to scene)
+    QPointF toPointF() const noexcept { return QPointF(x,y); }
+
+    bool operator==(const GridPoint &p) const noexcept { return x == p.x && y == p.y; }
+    bool operator!=(const GridPoint &p) const noexcept { return !(*this == p); }
+    GridPoint operator+(const GridPoint &p) const noexcept { return GridPoint(x+p.x,y+p.y); }
+    GridPoint operator-(const GridPoint &p) const noexcept { return GridPoint(x-p.x,y-p.y); }
+
+    //z component of (b-a)x(c-a): zero when a, b and c are aligned
+    static int64_t cross(const GridPoint &a,const GridPoint &b,const GridPoint &c) noexcept;
+};
+
+} // namespace GuiBlocks
+
+#endif // GUIBLOCKS_GRIDPOINT_H
@@ -0,0 +1,47 @@
+#include "GridRenderer.h"
+
+#include "Style.h"
+#include <QPen>
+#include <cmath>
+
+namespace GuiBlocks {
+
+void GridRenderer::draw(QPainter *painter,const QRectF &rect)
+{
+    //the view is not rotated, so m11 is its zoom
+    const double zoom = painter->worldTransform().m11();
+    const double fineStep   = StyleGrid::gridSize;
+    const double coarseStep = fineStep*double(StyleGrid::coarseGridFactor);
+
+    if( fineStep*zoom >= StyleGrid::minGridSpacing )
+    {
+        appendLines(rect,fineStep,StyleGrid::coarseGridFactor,lines);
+        painter->setPen(QPen(StyleGrid::fineGridColor,StyleGrid::fineGridWidth));
+        painter->drawLines(lines.data(),int(lines.size()));
+    }
+    if( coarseStep*zoom >= StyleGrid::minGridSpacing )
+    {
+        appendLines(rect,coarseStep,0,lines);
+        painter->setPen(QPen(StyleGrid::coarseGridColor,StyleGrid::coarseGridWidth));
+        painter->drawLines(lines.data(),int(lines.size()));
+    }
+}
+
+void GridRenderer::appendLines(const QRectF &rect,double step,int skipEvery,std::vector<QLineF> &lines)
+{
+    lines.clear();
+    //the lines just outside rect are included, their pen can reach into it
+    const auto left   = int(std::floor(rect.left()/step));
+    const auto right  = int(std::ceil(rect.right()/step));
+    const auto top    = int(std::floor(rect.top()/step));
+    const auto bottom = int(std::ceil(rect.bottom()/step));
+    lines.reserve(size_t(right-left+1)+size_t(bottom-top+1));
+    for( int xi=left ; xi<=right ; xi++ )
+        if( skipEvery == 0 || xi%skipEvery != 0 )
+            lines.emplace_back(xi*step,top*step,xi*step,bottom*step);
+    for( int yi=top ; yi<=bottom ; yi++ )
+        if( skipEvery == 0 || yi%skipEvery != 0 )
+            lines.emplace_back(left*step,yi*step,right*step,yi*step);
+}
+
+} // namespace GuiBlocks
@@ -0,0 +1,33 @@
+#ifndef GUIBLOCKS_GRIDRENDERER_H
+#define GUIBLOCKS_GRIDRENDERER_H
+
+#include <QLineF>
+#include <QPainter>
+#include <QRectF>
+#include <vector>
+
+namespace GuiBlocks {
+
+//Background grid of a view. Each grid is drawn with a single drawLines()
+//call, and only over the exposed rect. The grids whose lines would be
+//closer than StyleGrid::minGridSpacing pixels are not drawn (at the lowest
+//zoom of the view only the coarse grid is left), so the number of lines
+//does not grow when zooming out
+class GridRenderer
+{
+public:
+    //draws the grids over rect (scene coordinates)
+    void draw(QPainter *painter,const QRectF &rect);
+
+private:
+    //fills lines with the lines of a grid of step over rect, skipping
+    //every skipEvery lines (the ones drawn by the coarse grid)
+    static void appendLines(const QRectF &rect,double step,int skipEvery,std::vector<QLineF> &lines);
+
+    //kept to reuse the storage
+    std::vector<QLineF> lines;
+};
+
+} // namespace GuiBlocks
+
+#endif // GUIBLOCKS_GRIDRENDERER_H
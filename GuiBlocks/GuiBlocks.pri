@@ -0,0 +1,54 @@
+# The sources of GuiBlocks, shared by the application and the tests
+INCLUDEPATH += $$PWD/..
+
+SOURCES += \
+    $$PWD/Block.cpp \
+    $$PWD/BlockAtlas.cpp \
+    $$PWD/BlockPrototype.cpp \
+    $$PWD/DensityMap.cpp \
+    $$PWD/FrameStats.cpp \
+    $$PWD/GridPoint.cpp \
+    $$PWD/GridRenderer.cpp \
+    $$PWD/HitTester.cpp \
+    $$PWD/LayerCompositor.cpp \
+    $$PWD/Link.cpp \
+    $$PWD/MouseTracker.cpp \
+    $$PWD/Painter.cpp \
+    $$PWD/Panner.cpp \
+    $$PWD/ProgressiveZoom.cpp \
+    $$PWD/Scene.cpp \
+    $$PWD/SegmentGrid.cpp \
+    $$PWD/SegmentKernel.cpp \
+    $$PWD/ShadowCache.cpp \
+    $$PWD/Style.cpp \
+    $$PWD/TextCache.cpp \
+    $$PWD/Utils.cpp \
+    $$PWD/View.cpp \
+    $$PWD/ZOrderManager.cpp
+
+HEADERS += \
+    $$PWD/Block.h \
+    $$PWD/BlockAtlas.h \
+    $$PWD/BlockPrototype.h \
+    $$PWD/DensityMap.h \
+    $$PWD/FrameStats.h \
+    $$PWD/GridPoint.h \
+    $$PWD/GridRenderer.h \
+    $$PWD/HitTester.h \
+    $$PWD/LayerCompositor.h \
+    $$PWD/Link.h \
+    $$PWD/LinkIndex.h \
+    $$PWD/MouseTracker.h \
+    $$PWD/Painter.h \
+    $$PWD/Panner.h \
+    $$PWD/ProgressiveZoom.h \
+    $$PWD/Scene.h \
+    $$PWD/SegmentGrid.h \
+    $$PWD/SegmentKernel.h \
+    $$PWD/ShadowCache.h \
+    $$PWD/Style.h \
+    $$PWD/TextCache.h \
+    $$PWD/TypeID.h \
+    $$PWD/Utils.h \
+    $$PWD/View.h \
+    $$PWD/ZOrderManager.h
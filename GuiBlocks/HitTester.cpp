@@ -0,0 +1,278 @@
+#include "HitTester.h"
+
+#include "Link.h"
+#include "Style.h"
+#include "Utils.h"
+#include <algorithm>
+#include <cmath>
+
+namespace GuiBlocks {
+
+void HitTester::insert(QGraphicsItem *item)
+{
+    Kind kind;
+    if( qgraphicsitem_cast<Block*>(item) )
+        kind = Kind::Block;
+    else if( qgraphicsitem_cast<Link*>(item) )
+        kind = Kind::Link;
+    else
+        return;
+    if( slotOf.count(item) )
+    {
+        update(item);
+        return;
+    }
+    const auto slot = uint32_t(items.size());
+    left.push_back(0);
+    top.push_back(0);
+    right.push_back(0);
+    bottom.push_back(0);
+    z.push_back(0);
+    order.push_back(nextOrder++);
+    kinds.push_back(kind);
+    items.push_back(item);
+    levelOf.push_back(0);
+    slotOf.emplace(item,slot);
+    store(slot,item);
+    index(slot);
+}
+
+void HitTester::remove(const QGraphicsItem *item)
+{
+    auto it = slotOf.find(item);
+    if( it == slotOf.end() )
+        return;
+    //the last slot is moved to the removed one
+    const auto slot = it->second;
+    const auto last = uint32_t(items.size()-1);
+    slotOf.erase(it);
+    unindex(slot);
+    if( slot != last )
+    {
+        unindex(last);
+        left[slot]   = left[last];
+        top[slot]    = top[last];
+        right[slot]  = right[last];
+        bottom[slot] = bottom[last];
+        z[slot]      = z[last];
+        order[slot]  = order[last];
+        kinds[slot]  = kinds[last];
+        items[slot]  = items[last];
+        slotOf[items[slot]] = slot;
+        index(slot);
+    }
+    left.pop_back();
+    top.pop_back();
+    right.pop_back();
+    bottom.pop_back();
+    z.pop_back();
+    order.pop_back();
+    kinds.pop_back();
+    items.pop_back();
+    levelOf.pop_back();
+}
+
+void HitTester::update(const QGraphicsItem *item)
+{
+    auto it = slotOf.find(item);
+    if( it == slotOf.end() )
+        return;
+    const auto slot = it->second;
+    const auto rect = item->sceneBoundingRect();
+    //most updates are z changes, which do not move the item in the grids
+    if( rect.left() == left[slot] && rect.top() == top[slot] &&
+        rect.right() == right[slot] && rect.bottom() == bottom[slot] )
+    {
+        z[slot] = item->zValue();
+        return;
+    }
+    //the small moves of a drag stay in the same cells, which are left as
+    //they are (no hash nodes freed and allocated again)
+    const int level = levelFor(rect);
+    if( level == levelOf[slot] &&
+        cellOf(rect.left(),level)  == cellOf(left[slot],level) &&
+        cellOf(rect.right(),level) == cellOf(right[slot],level) &&
+        cellOf(rect.top(),level)   == cellOf(top[slot],level) &&
+        cellOf(rect.bottom(),level) == cellOf(bottom[slot],level) )
+    {
+        store(slot,item);
+        return;
+    }
+    unindex(slot);
+    store(slot,item);
+    index(slot);
+}
+
+void HitTester::clear() noexcept
+{
+    left.clear();
+    top.clear();
+    right.clear();
+    bottom.clear();
+    z.clear();
+    order.clear();
+    kinds.clear();
+    items.clear();
+    levelOf.clear();
+    slotOf.clear();
+    for( int level=0 ; level<levels ; level++ )
+    {
+        cells[level].clear();
+        levelCount[level] = 0;
+    }
+}
+
+HitTester::Result HitTester::itemAt(const QPointF &pos,bool gridPosition)
+{
+    collect(pos);
+    const auto gridPos = nextGridPosition(pos,StyleGrid::gridSize);
+    QRectF rect(0.0,0.0,StyleGrid::gridSize,StyleGrid::gridSize);
+    rect.moveCenter(pos);
+    Result result;
+    for( auto slot : candidates )
+    {
+        if( kinds[slot] == Kind::Block )
+        {
+            auto block = static_cast<Block*>(items[slot]);
+            const auto blockPos = block->mapFromScene(pos);
+            if( auto port = block->isMouseOverPort(blockPos) )
+            {
+                result.port  = port;
+                result.block = block;
+                return result;
+            }
+            if( block->isMouseOverBlock(blockPos) )
+            {
+                result.block = block;
+                return result;
+            }
+        }
+        else
+        {
+            auto link = static_cast<Link*>(items[slot]);
+            if( gridPosition ? link->isPartOfLink(gridPos) : link->isPartOfLink(rect) )
+            {
+                result.link = link;
+                return result;
+            }
+        }
+    }
+    return result;
+}
+
+const std::vector<Link*>& HitTester::linksAt(const QPointF &pos,bool gridPosition)
+{
+    collect(pos);
+    const auto testPos = gridPosition ? nextGridPosition(pos,StyleGrid::gridSize) : pos;
+    links.clear();
+    for( auto slot : candidates )
+        if( kinds[slot] == Kind::Link )
+        {
+            auto link = static_cast<Link*>(items[slot]);
+            if( link->isPartOfLink(testPos) )
+                links.push_back(link);
+        }
+    return links;
+}
+
+void HitTester::collect(const QPointF &pos)
+{
+    const double x = pos.x();
+    const double y = pos.y();
+    candidates.clear();
+    for( int level=0 ; level<levels ; level++ )
+    {
+        if( levelCount[level] == 0 )
+            continue;
+        auto cell = cells[level].find(cellKey(cellOf(x,level),cellOf(y,level)));
+        if( cell == cells[level].end() )
+            continue;
+        for( auto i : cell->second )
+            if( x >= left[i] && x <= right[i] && y >= top[i] && y <= bottom[i] )
+                candidates.push_back(i);
+    }
+    //stacking order of the scene: higher z first, and the last inserted
+    //first on equal z. There are only a few items under a point, so an
+    //insertion sort is enough
+    auto above = [this](uint32_t a,uint32_t b)
+    {
+        return z[a] > z[b] || (z[a] == z[b] && order[a] > order[b]);
+    };
+    for( size_t i=1 ; i<candidates.size() ; i++ )
+    {
+        const auto slot = candidates[i];
+        auto j = i;
+        for( ; j>0 && above(slot,candidates[j-1]) ; j-- )
+            candidates[j] = candidates[j-1];
+        candidates[j] = slot;
+    }
+}
+
+void HitTester::store(uint32_t slot,const QGraphicsItem *item)
+{
+    const auto rect = item->sceneBoundingRect();
+    left[slot]   = rect.left();
+    top[slot]    = rect.top();
+    right[slot]  = rect.right();
+    bottom[slot] = rect.bottom();
+    z[slot]      = item->zValue();
+}
+
+double HitTester::cellSize(int level) noexcept
+{
+    //the cells of the first level are the ones of the coarse grid
+    return StyleGrid::gridSize*double(StyleGrid::coarseGridFactor)*double(uint32_t(1) << level);
+}
+
+uint64_t HitTester::cellKey(int32_t x,int32_t y) noexcept
+{
+    return (uint64_t(uint32_t(x)) << 32) | uint64_t(uint32_t(y));
+}
+
+int32_t HitTester::cellOf(double val,int level) noexcept
+{
+    return int32_t(std::floor(val/cellSize(level)));
+}
+
+int HitTester::levelFor(const QRectF &rect) noexcept
+{
+    //the first level whose cells are as large as the rect (the last one
+    //takes the larger ones)
+    const double size = std::max(rect.width(),rect.height());
+    int level = 0;
+    while( level < levels-1 && cellSize(level) < size )
+        level++;
+    return level;
+}
+
+void HitTester::index(uint32_t slot)
+{
+    const int level = levelFor(QRectF(QPointF(left[slot],top[slot]),QPointF(right[slot],bottom[slot])));
+    levelOf[slot] = uint8_t(level);
+    levelCount[level]++;
+    const auto lastX = cellOf(right[slot],level);
+    const auto lastY = cellOf(bottom[slot],level);
+    for( auto x=cellOf(left[slot],level) ; x<=lastX ; x++ )
+        for( auto y=cellOf(top[slot],level) ; y<=lastY ; y++ )
+            cells[level][cellKey(x,y)].push_back(slot);
+}
+
+void HitTester::unindex(uint32_t slot)
+{
+    const int level = levelOf[slot];
+    levelCount[level]--;
+    const auto lastX = cellOf(right[slot],level);
+    const auto lastY = cellOf(bottom[slot],level);
+    for( auto x=cellOf(left[slot],level) ; x<=lastX ; x++ )
+        for( auto y=cellOf(top[slot],level) ; y<=lastY ; y++ )
+        {
+            auto cell = cells[level].find(cellKey(x,y));
+            auto &inCell = cell->second;
+            *std::find(inCell.begin(),inCell.end(),slot) = inCell.back();
+            inCell.pop_back();
+            if( inCell.empty() )
+                cells[level].erase(cell);
+        }
+}
+
+} // namespace GuiBlocks
@@ -0,0 +1,94 @@
+#ifndef GUIBLOCKS_HITTESTER_H
+#define GUIBLOCKS_HITTESTER_H
+
+#include <QGraphicsItem>
+#include <QPointF>
+#include <QRectF>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "GuiBlocks/Block.h"
+
+namespace GuiBlocks {
+
+class Link;
+
+//Answers "which port, block or link is under this scene point" for the
+//View without going through QGraphicsScene::items() (which builds a QList
+//on every call). The Scene registers its blocks and links (see
+//Scene::itemChange()), and their scene rects, z values and insertion order
+//are kept in flat arrays.
+//The slots are indexed by a pyramid of uniform grids (each level doubles
+//the cell of the previous one). An item is stored in the first level whose
+//cells are as large as its rect, so it touches at most 2x2 cells, and a
+//point query only visits one cell per level holding items.
+//The queries reuse the scratch buffers, so they do not allocate once the
+//buffers have grown to the number of items under the point
+class HitTester
+{
+public:
+    struct Result
+    {
+        Block::Port *port  = nullptr;   //when set, block is its parent
+        Block       *block = nullptr;
+        Link        *link  = nullptr;
+        explicit operator bool() const noexcept { return block != nullptr || link != nullptr; }
+    };
+
+    void insert(QGraphicsItem *item);
+    void remove(const QGraphicsItem *item);
+    //the scene rect or the z value of item changed
+    void update(const QGraphicsItem *item);
+    void clear() noexcept;
+
+    //the topmost item under pos (scene coordinates) in the following order:
+    //1- block port
+    //2- block (dragArea)
+    //3- link
+    //The links are tested at the nearest grid position when gridPosition
+    //is set, otherwise in a grid sized rect centered at pos
+    Result itemAt(const QPointF &pos,bool gridPosition);
+    //the links under pos (at the nearest grid position when gridPosition
+    //is set), topmost first. The vector is reused by the next query
+    const std::vector<Link*>& linksAt(const QPointF &pos,bool gridPosition);
+
+private:
+    enum class Kind : uint8_t { Block, Link };
+
+    static constexpr int levels = 24;
+
+    //fills candidates with the slots whose rect contains pos, topmost first
+    void collect(const QPointF &pos);
+    void store(uint32_t slot,const QGraphicsItem *item);
+    static double cellSize(int level) noexcept;
+    static uint64_t cellKey(int32_t x,int32_t y) noexcept;
+    static int32_t cellOf(double val,int level) noexcept;
+    //the level of the grids that indexes rect
+    static int levelFor(const QRectF &rect) noexcept;
+    //adds or removes slot in the cells covered by its rect
+    void index(uint32_t slot);
+    void unindex(uint32_t slot);
+
+    //one slot per item (structure of arrays, so the cells only hold slots)
+    std::vector<double>          left;
+    std::vector<double>          top;
+    std::vector<double>          right;
+    std::vector<double>          bottom;
+    std::vector<double>          z;
+    std::vector<uint64_t>        order;   //insertion order, breaks the ties of z
+    std::vector<Kind>            kinds;
+    std::vector<QGraphicsItem*>  items;
+    std::vector<uint8_t>         levelOf;
+    std::unordered_map<const QGraphicsItem*,uint32_t> slotOf;
+    std::unordered_map<uint64_t,std::vector<uint32_t>> cells[levels];
+    uint32_t levelCount[levels] = {};    //slots per level, the empty levels are skipped
+    uint64_t nextOrder = 0;
+
+    //scratch buffers of the queries
+    std::vector<uint32_t> candidates;
+    std::vector<Link*>    links;
+};
+
+} // namespace GuiBlocks
+
+#endif // GUIBLOCKS_HITTESTER_H
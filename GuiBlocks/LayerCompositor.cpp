@@ -0,0 +1,202 @@
+#include "LayerCompositor.h"
+
+#include <QGraphicsScene>
+#include <QMetaObject>
+#include <QStyleOptionGraphicsItem>
+#include <algorithm>
+
+namespace GuiBlocks {
+
+LayerCompositor::LayerCompositor()
+{
+    //one tile per tick, the events of the edit are handled in between
+    recordTimer.setInterval(0);
+    QObject::connect(&recordTimer,&QTimer::timeout,[this]{ recordNext(); });
+}
+
+LayerCompositor::~LayerCompositor()
+{
+    end();
+    //the running rasterizations post their tiles to the viewport
+    pool.waitForDone();
+}
+
+void LayerCompositor::begin(QGraphicsView *view,const std::vector<QGraphicsItem*> &activeItems)
+{
+    end();
+    this->view = view;
+    this->activeItems = activeItems;
+    //the active items are drawn over the static ones in their stacking order
+    std::sort(this->activeItems.begin(),this->activeItems.end(),
+              [](const QGraphicsItem *a,const QGraphicsItem *b){ return a->zValue() < b->zValue(); });
+    transform = view->viewportTransform();
+    size = view->viewport()->size();
+
+    const QRect viewport(QPoint(),size);
+    for( int y=0 ; y<size.height() ; y+=tileSize )
+        for( int x=0 ; x<size.width() ; x+=tileSize )
+            tiles.push_back({QRect(x,y,tileSize,tileSize) & viewport,QImage(),TileState::Pending,0});
+
+    //the paints of the edit are around the active items, so their tiles
+    //are recorded first
+    QRectF active;
+    for( auto item : this->activeItems )
+        active |= transform.mapRect(item->sceneBoundingRect());
+    const QPointF center = active.center();
+    auto distance = [&](size_t idx)
+    {
+        const QPointF delta = QRectF(tiles[idx].rect).center()-center;
+        return delta.x()*delta.x()+delta.y()*delta.y();
+    };
+    for( size_t idx=0 ; idx<tiles.size() ; idx++ )
+        queue.push_back(idx);
+    std::sort(queue.begin(),queue.end(),[&](size_t a,size_t b){ return distance(a) > distance(b); });
+    recordTimer.start();
+}
+
+void LayerCompositor::end() noexcept
+{
+    generation++;
+    view = nullptr;
+    activeItems.clear();
+    tiles.clear();
+    queue.clear();
+    recordTimer.stop();
+    //the queued rasterizations are not started
+    pool.clear();
+}
+
+bool LayerCompositor::hasActiveItems(const std::vector<QGraphicsItem*> &items) const
+{
+    if( items.size() != activeItems.size() )
+        return false;
+    for( auto item : items )
+        if( !isActiveItem(item) )
+            return false;
+    return true;
+}
+
+bool LayerCompositor::isStale() const
+{
+    return view->viewportTransform() != transform || view->viewport()->size() != size;
+}
+
+bool LayerCompositor::isReady(const QRect &rect) const
+{
+    for( const auto &tile : tiles )
+        if( tile.state != TileState::Ready && tile.rect.intersects(rect) )
+            return false;
+    return true;
+}
+
+void LayerCompositor::invalidate(const QGraphicsItem *item)
+{
+    if( !isActive() || isActiveItem(item) )
+        return;
+    const QRectF rect = transform.mapRect(item->sceneBoundingRect());
+    for( size_t idx=0 ; idx<tiles.size() ; idx++ )
+    {
+        auto &tile = tiles[idx];
+        if( tile.state == TileState::Pending || !QRectF(tile.rect).intersects(rect) )
+            continue;
+        //the image being rasterized or drawn is the one of the old state
+        tile.state = TileState::Pending;
+        tile.version++;
+        queue.push_back(idx);
+    }
+    if( !queue.empty() )
+        recordTimer.start();
+}
+
+void LayerCompositor::draw(QPainter *painter,const QRect &rect)
+{
+    for( const auto &tile : tiles )
+        if( tile.rect.intersects(rect) )
+            painter->drawImage(tile.rect.topLeft(),tile.image);
+
+    const QRectF exposed = view->mapToScene(rect).boundingRect();
+    QStyleOptionGraphicsItem option;
+    for( auto item : activeItems )
+    {
+        if( !item->isVisible() || !item->sceneBoundingRect().intersects(exposed) )
+            continue;
+        painter->setTransform(item->sceneTransform()*transform);
+        painter->setOpacity(item->effectiveOpacity());
+        option.exposedRect = item->boundingRect();
+        item->paint(painter,&option,view->viewport());
+    }
+    painter->resetTransform();
+    painter->setOpacity(1.0);
+}
+
+bool LayerCompositor::isActiveItem(const QGraphicsItem *item) const
+{
+    return std::find(activeItems.begin(),activeItems.end(),item) != activeItems.end();
+}
+
+QPicture LayerCompositor::record(const QRect &tile) const
+{
+    QPicture picture;
+    QPainter painter(&picture);
+    painter.setRenderHints(view->renderHints());
+    const QRectF exposed = view->mapToScene(tile).boundingRect();
+    const QTransform toTile = transform*QTransform::fromTranslate(-tile.x(),-tile.y());
+    QStyleOptionGraphicsItem option;
+    for( auto item : view->scene()->items(exposed,Qt::IntersectsItemBoundingRect,Qt::AscendingOrder) )
+    {
+        if( !item->isVisible() || isActiveItem(item) )
+            continue;
+        painter.setTransform(item->sceneTransform()*toTile);
+        painter.setOpacity(item->effectiveOpacity());
+        option.exposedRect = item->boundingRect();
+        //without a widget the blocks draw their bodies instead of taking
+        //them from the BlockAtlas (its pixmaps can not leave the GUI thread)
+        item->paint(&painter,&option,nullptr);
+    }
+    painter.end();
+    return picture;
+}
+
+void LayerCompositor::rasterize(size_t idx,QPicture picture)
+{
+    const auto rect = tiles[idx].rect;
+    const auto current = generation;
+    const auto version = tiles[idx].version;
+    const auto dpr = view->viewport()->devicePixelRatioF();
+    QWidget *viewport = view->viewport();
+    pool.start([this,idx,rect,current,version,dpr,viewport,picture]() mutable
+    {
+        QImage image(rect.size()*dpr,QImage::Format_ARGB32_Premultiplied);
+        image.setDevicePixelRatio(dpr);
+        image.fill(Qt::transparent);
+        QPainter painter(&image);
+        picture.play(&painter);
+        painter.end();
+        //the tiles are only touched by the GUI thread
+        QMetaObject::invokeMethod(viewport,[this,idx,current,version,image]
+        {
+            if( current != generation || version != tiles[idx].version )
+                return;
+            tiles[idx].image = image;
+            tiles[idx].state = TileState::Ready;
+            view->viewport()->update(tiles[idx].rect);
+        },Qt::QueuedConnection);
+    });
+}
+
+void LayerCompositor::recordNext()
+{
+    if( queue.empty() )
+    {
+        recordTimer.stop();
+        return;
+    }
+    const auto idx = queue.back();
+    queue.pop_back();
+    tiles[idx].state = TileState::Rasterizing;
+    rasterize(idx,record(tiles[idx].rect));
+    if( queue.empty() )
+        recordTimer.stop();
+}
+
+} // namespace GuiBlocks
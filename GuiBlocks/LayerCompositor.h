@@ -0,0 +1,96 @@
+#ifndef GUIBLOCKS_LAYERCOMPOSITOR_H
+#define GUIBLOCKS_LAYERCOMPOSITOR_H
+
+#include <QGraphicsItem>
+#include <QGraphicsView>
+#include <QImage>
+#include <QPainter>
+#include <QPicture>
+#include <QRect>
+#include <QSize>
+#include <QThreadPool>
+#include <QTimer>
+#include <QTransform>
+#include <cstdint>
+#include <vector>
+
+namespace GuiBlocks {
+
+//Draws a View while some items are being edited (a dragged block and its
+//links, or the link being drawn or moved) as two layers:
+// - the static layer: the rest of the items, rasterized once in tiles of
+//   the viewport. The items of each tile are recorded in a QPicture in the
+//   GUI thread (the items and their caches are not thread safe) and the
+//   picture is played into a QImage by a thread of the pool.
+//   The tiles are recorded one per timer tick, the nearest to the active
+//   items first, so begin() does not block the event that starts the edit.
+//   Until the tiles over a paint are ready, the View draws it as usual.
+// - the active layer: the edited items, drawn live over the tiles.
+//The static items that change during the edit (as the blocks whose ports
+//are connected) are recorded again (invalidate()).
+//The static layer is dropped by end(), when the edit is committed, and
+//has to be built again (begin()) if the view is scrolled, zoomed or resized
+class LayerCompositor
+{
+public:
+    LayerCompositor();
+    ~LayerCompositor();
+
+    //starts rasterizing the static layer of view without activeItems
+    void begin(QGraphicsView *view,const std::vector<QGraphicsItem*> &activeItems);
+    //drops the static layer (the rasterizations in progress are discarded)
+    void end() noexcept;
+    bool isActive() const noexcept { return view != nullptr; }
+    //true if items are the active items (in any order)
+    bool hasActiveItems(const std::vector<QGraphicsItem*> &items) const;
+    //true if the view has been scrolled, zoomed or resized since begin()
+    bool isStale() const;
+    //true if the tiles over rect (viewport coordinates) are rasterized
+    bool isReady(const QRect &rect) const;
+    //records again the tiles of item, if it is in the static layer
+    void invalidate(const QGraphicsItem *item);
+
+    //draws the tiles and the active items over rect (viewport coordinates),
+    //the painter must be untransformed
+    void draw(QPainter *painter,const QRect &rect);
+
+private:
+    enum class TileState : uint8_t
+    {
+        Pending,        //waiting in the queue to be recorded
+        Rasterizing,
+        Ready
+    };
+    struct Tile
+    {
+        QRect rect;     //viewport coordinates
+        QImage image;
+        TileState state = TileState::Pending;
+        uint32_t version = 0;   //each recording of the tile, the older images are discarded
+    };
+
+    static constexpr int tileSize = 256;
+
+    bool isActiveItem(const QGraphicsItem *item) const;
+    //records the static items over the tile
+    QPicture record(const QRect &tile) const;
+    void rasterize(size_t idx,QPicture picture);
+    //records the next tile of the queue
+    void recordNext();
+
+    QGraphicsView *view = nullptr;
+    QTransform transform;   //viewport transform of begin()
+    QSize size;             //viewport size of begin()
+    std::vector<QGraphicsItem*> activeItems;
+    std::vector<Tile> tiles;
+    std::vector<size_t> queue;  //the pending tiles, the next one last
+    QTimer recordTimer;
+    //each begin() starts a generation, the tiles of the previous ones are
+    //discarded when they arrive
+    uint64_t generation = 0;
+    QThreadPool pool;
+};
+
+} // namespace GuiBlocks
+
+#endif // GUIBLOCKS_LAYERCOMPOSITOR_H
@@ -2,533 +2,545 @@
 
 #include <QDebug>
 #include <QPainter>
+#include "Scene.h"
+#include "ShadowCache.h"
 #include "Utils.h"
+#include <algorithm>
 #include <cmath>
 
 namespace GuiBlocks {
 
 //--------------------------------------
-//------ Link::LinkBinTree::Node  ------
-Link::LinkBinTree::Node::Node() noexcept
-{
-    makeEmpty();
-    resetIndexs();
-}
-
-Link::LinkBinTree::Node::Node(Link::LinkBinTree::Node &&n)
-{
-    this->connectionPort = n.connectionPort;
-    this->firstChildIdx = n.firstChildIdx;
-    this->parentNextChildIdx = n.parentNextChildIdx;
-    this->point = n.point;
-    this->prevNode = n.prevNode;
-    //this will avoid disconnection from block port if n is destructed
-    n.connectionPort.port = nullptr;
-}
-
-Link::LinkBinTree::Node::Node(const QPointF &point,
-                              uint16_t parentIdx,
-                              uint16_t firstChildIdx,
-                              uint16_t parentNextChildIdx) noexcept
-{
-    setData(point,parentIdx,firstChildIdx,parentNextChildIdx);
-}
-
-Link::LinkBinTree::Node::~Node()
-{
-    makeEmpty();
-}
-
-//Link::LinkBinTree::Node &Link::LinkBinTree::Node::operator=(const Link::LinkBinTree::Node &n)
-//{
-//    this->prevNode =
-//    return *this;
-//}
-
-bool Link::LinkBinTree::Node::isEmpty() const noexcept
-{
-    return qIsNaN(point.x());
-//    return (firstChildIdx      == invalid_index) &&
-//           (parentNextChildIdx == invalid_index) &&
-//           (prevNode           == invalid_index);
-}
-
-void Link::LinkBinTree::Node::makeEmpty() noexcept
-{
-    if( connectionPort.port != nullptr )
-    {
-        connectionPort.port->disconnectPortFromLink();
-        //connectionPort.port = nullptr;
-        //connectionPort.connected = false;
-    }
-    point.setX(qQNaN());
-//    firstChildIdx = invalid_index;
-//    parentNextChildIdx = invalid_index;
-//    prevNode = invalid_index;
-}
-
-void Link::LinkBinTree::Node::resetIndexs() noexcept
-{
-    prevNode = invalid_index;
-    firstChildIdx = invalid_index;
-    parentNextChildIdx = invalid_index;
-}
-
-void Link::LinkBinTree::Node::setData(const QPointF &point,
-                                      uint16_t parentIdx,
-                                      uint16_t firstChildIdx,
-                                      uint16_t parentNextChildIdx) noexcept
-{
-    this->point    = point;
-    this->prevNode = parentIdx;
-    this->firstChildIdx      = firstChildIdx;
-    this->parentNextChildIdx = parentNextChildIdx;
+//------ Link::BasicLinkBinTree --------
+template<typename Index,typename Access>
+Link::BasicLinkBinTree<Index,Access>::BasicLinkBinTree(const GridPoint &pos) noexcept
+{
+    x.reserve(6);
+    y.reserve(6);
+    prev.reserve(6);
+    firstChild.reserve(6);
+    nextSibling.reserve(6);
+    parent.reserve(6);
+    childCount.reserve(6);
+    createNode(pos);
+    rootIdx = 0;
 }
 
-void Link::LinkBinTree::Node::show() noexcept
+template<typename Index,typename Access>
+Link::BasicLinkBinTree<Index,Access>::~BasicLinkBinTree()
 {
-    if( isEmpty() )
-        qDebug() << "empty";
-    else
+    for( auto &binding : ports )
     {
-        QString left = "X";
-        if( firstChildIdx != invalid_index )
-            left = QString::number(firstChildIdx);
-        QString right = "X";
-        if( parentNextChildIdx != invalid_index )
-            right = QString::number(parentNextChildIdx);
-        QString prev = "X";
-        if( prevNode != invalid_index )
-            prev = QString::number(prevNode);
-        qDebug() << point << prev << left << right;
+        binding.port->connectionLink.link    = nullptr;
+        binding.port->connectionLink.nodeIdx = LinkBinTree::invalid_index;
     }
 }
 
-//--------------------------------------
-//------ Link::LinkBinTree -------------
-Link::LinkBinTree::LinkBinTree(const QPointF &pos) noexcept
-{
-    nodes.reserve(6);
-    nodes.emplace_back(pos);
-    rootIdx = 0;
-}
-
-uint16_t Link::LinkBinTree::appendChild(uint16_t parentIdx,
-                                        const QPointF &point) noexcept
+template<typename Index,typename Access>
+Index Link::BasicLinkBinTree<Index,Access>::appendChild(Index parentIdx,
+                                        const GridPoint &point) noexcept
 {
-    if( parentIdx >= nodes.size() )
+    if( parentIdx >= x.size() )
         return invalid_index;
 
     //a parentIdx empty implies that the node is not being used, so
     //we can not append a child to it
-    if( nodes[parentIdx].isEmpty() )
+    if( isEmpty(parentIdx) )
         return invalid_index;
 
-    auto childIdx = nodes[parentIdx].firstChildIdx;
+    auto childIdx = firstChild[parentIdx];
     if( childIdx == invalid_index )
     {
-        nodes[parentIdx].firstChildIdx = createNode(point,parentIdx);
-        return nodes[parentIdx].firstChildIdx;//parentNextChildIdx;
+        auto idx = createNode(point,parentIdx,parentIdx);
+        if( idx != invalid_index )
+        {
+            firstChild[parentIdx] = idx;
+            childCount[parentIdx]++;
+        }
+        return idx;
     }
+    auto lastChildIdx = childIdx;
     while( childIdx != invalid_index )
     {
-        parentIdx = childIdx;
-        childIdx = nodes[parentIdx].parentNextChildIdx;
+        lastChildIdx = childIdx;
+        childIdx = nextSibling[lastChildIdx];
+    }
+    auto idx = createNode(point,parentIdx,lastChildIdx);
+    if( idx != invalid_index )
+    {
+        nextSibling[lastChildIdx] = idx;
+        childCount[parentIdx]++;
     }
-    nodes[parentIdx].parentNextChildIdx = createNode(point,parentIdx);
-    return nodes[parentIdx].parentNextChildIdx;
+    return idx;
 }
 
-uint16_t Link::LinkBinTree::insertBefore(uint16_t targetIdx,const QPointF &point) noexcept
+template<typename Index,typename Access>
+Index Link::BasicLinkBinTree<Index,Access>::insertBefore(Index targetIdx,const GridPoint &point) noexcept
 {
+    //the new node takes the place of targetIdx in the children of its
+    //parent (so the count of the parent does not change), and targetIdx
+    //becomes its only child
     auto idx = createNode(point,
-                          nodes[targetIdx].prevNode,
+                          parent[targetIdx],
+                          prev[targetIdx],
                           targetIdx,
-                          nodes[targetIdx].parentNextChildIdx);
-    auto prev = nodes[targetIdx].prevNode;
-    if( prev == invalid_index )
+                          nextSibling[targetIdx]);
+    if( idx == invalid_index )
+        return idx;
+    auto prevIdx = prev[targetIdx];
+    if( prevIdx == invalid_index )
         rootIdx = idx;
     else
     {
-        if( nodes[prev].firstChildIdx == targetIdx )
-            nodes[prev].firstChildIdx = idx;
+        if( firstChild[prevIdx] == targetIdx )
+            firstChild[prevIdx] = idx;
         else
-            nodes[prev].parentNextChildIdx = idx;
+            nextSibling[prevIdx] = idx;
     }
-    nodes[targetIdx].prevNode = idx;
-    if( nodes[targetIdx].parentNextChildIdx != invalid_index )
-        nodes[nodes[targetIdx].parentNextChildIdx].prevNode = idx;
-    nodes[targetIdx].parentNextChildIdx = invalid_index;
+    prev[targetIdx]   = idx;
+    parent[targetIdx] = idx;
+    if( nextSibling[targetIdx] != invalid_index )
+        prev[nextSibling[targetIdx]] = idx;
+    nextSibling[targetIdx] = invalid_index;
     return idx;
 }
 
-void Link::LinkBinTree::removeSubTree(uint16_t targetIdx) noexcept
+template<typename Index,typename Access>
+void Link::BasicLinkBinTree<Index,Access>::removeSubTree(Index targetIdx) noexcept
 {
-    resetSubTreeIterator(targetIdx);
-    iterateSubTree();
-    auto idx = iterateSubTree();
+    //the released nodes are chained in the free list, which overwrites
+    //their links, so the descendants are released in post-order (a node
+    //is released after its children, and its links are read before)
+    auto idx = firstChild[targetIdx];
     while( idx != invalid_index )
     {
-        nodes[idx].makeEmpty();
-        idx = iterateSubTree();
+        while( firstChild[idx] != invalid_index )
+            idx = firstChild[idx];
+        while( true )
+        {
+            const auto siblingIdx = nextSibling[idx];
+            const auto parentIdx  = parent[idx];
+            releaseNode(idx);
+            if( siblingIdx != invalid_index )
+            {
+                idx = siblingIdx;
+                break;
+            }
+            if( parentIdx == targetIdx )
+            {
+                idx = invalid_index;
+                break;
+            }
+            //all the children of parentIdx were released
+            idx = parentIdx;
+        }
     }
-    nodes[targetIdx].firstChildIdx = invalid_index;
-    if( nodes[targetIdx].parentNextChildIdx == invalid_index )
+    firstChild[targetIdx] = invalid_index;
+    childCount[targetIdx] = 0;
+    if( nextSibling[targetIdx] == invalid_index )
     {
-        auto prev = nodes[targetIdx].prevNode;
-        if( prev != invalid_index )
+        auto prevIdx = prev[targetIdx];
+        if( prevIdx != invalid_index )
         {
-            //qDebug() << getParent(targetIdx);
-            if( isParent(prev,targetIdx) )
-                nodes[prev].firstChildIdx = invalid_index;
+            if( isParent(prevIdx,targetIdx) )
+                firstChild[prevIdx] = invalid_index;
             else
-                nodes[prev].parentNextChildIdx = invalid_index;
+                nextSibling[prevIdx] = invalid_index;
         }
-        nodes[targetIdx].makeEmpty();
+        if( auto parentIdx = parent[targetIdx]; parentIdx != invalid_index )
+            childCount[parentIdx]--;
+        releaseNode(targetIdx);
     }
 }
 
-uint16_t Link::LinkBinTree::childrenCount(uint16_t targetIdx) noexcept
+template<typename Index,typename Access>
+Block::Port *Link::BasicLinkBinTree<Index,Access>::getPort(Index idx) const noexcept
 {
-    if( auto idx = nodes[targetIdx].firstChildIdx; idx != invalid_index )
-    {
-        //nodes[targetIdx].show();
-        uint16_t count = 1;
-        while( nodes[idx].parentNextChildIdx != invalid_index )
-        {
-            count++;
-            //nodes[idx].show();
-            idx = nodes[idx].parentNextChildIdx;
-        }
-        return count;
-    }
-    return 0;
+    for( const auto &binding : ports )
+        if( binding.nodeIdx == idx )
+            return binding.port;
+    return nullptr;
 }
 
-uint16_t Link::LinkBinTree::getParent(uint16_t targetIdx) const noexcept
+template<typename Index,typename Access>
+void Link::BasicLinkBinTree<Index,Access>::setPort(Index idx,Block::Port *port) noexcept
 {
-    if( targetIdx == rootIdx )
-        return invalid_index;
-    while( targetIdx != invalid_index )
+    auto binding = std::find_if(ports.begin(),ports.end(),
+                                [idx](const PortBinding &b){ return b.nodeIdx == idx; });
+    if( port == nullptr )
     {
-        if( !prevNodeIsParent(targetIdx) )
-            targetIdx = nodes[targetIdx].prevNode;
-        else
-            return nodes[targetIdx].prevNode;//targetIdx;
+        if( binding != ports.end() )
+            ports.erase(binding);
+        return;
     }
-    return invalid_index;
+    if( binding != ports.end() )
+        binding->port = port;
+    else
+        ports.push_back({idx,port});
 }
 
-QPointF &Link::LinkBinTree::operator[](uint16_t idx)
+template<typename Index,typename Access>
+std::vector<Index> Link::BasicLinkBinTree<Index,Access>::compact()
 {
-    if( idx >= nodes.size() )
-        throw("index out of range");
-
-    if( nodes[idx].isEmpty() )
-        throw("accesing to an invalid (empty/unused) node");
-
-    return nodes[idx].point;
+    std::vector<Index> remap(x.size(),invalid_index);
+    Index count = 0;
+    for( Index idx=0 ; idx<x.size() ; idx++ )
+        if( !isEmpty(idx) )
+            remap[idx] = count++;
+    auto remapIdx = [&remap](Index idx)
+    {
+        return idx == invalid_index ? invalid_index : remap[idx];
+    };
+    //the nodes only move to lower indexes, so they can be moved in place
+    for( Index idx=0 ; idx<x.size() ; idx++ )
+    {
+        const auto to = remap[idx];
+        if( to == invalid_index )
+            continue;
+        x[to]           = x[idx];
+        y[to]           = y[idx];
+        prev[to]        = remapIdx(prev[idx]);
+        firstChild[to]  = remapIdx(firstChild[idx]);
+        nextSibling[to] = remapIdx(nextSibling[idx]);
+        parent[to]      = remapIdx(parent[idx]);
+        childCount[to]  = childCount[idx];
+    }
+    x.resize(count);
+    y.resize(count);
+    prev.resize(count);
+    firstChild.resize(count);
+    nextSibling.resize(count);
+    parent.resize(count);
+    childCount.resize(count);
+    x.shrink_to_fit();
+    y.shrink_to_fit();
+    prev.shrink_to_fit();
+    firstChild.shrink_to_fit();
+    nextSibling.shrink_to_fit();
+    parent.shrink_to_fit();
+    childCount.shrink_to_fit();
+    for( auto &binding : ports )
+    {
+        binding.nodeIdx = remap[binding.nodeIdx];
+        binding.port->connectionLink.nodeIdx = LinkIndex(binding.nodeIdx);
+    }
+    rootIdx  = remapIdx(rootIdx);
+    freeHead = invalid_index;
+    //the nodes that hold the bounds are used nodes, so they are remapped
+    for( auto &holder : bounds.holder )
+        holder = remapIdx(holder);
+    invalidateSegments();
+    return remap;
 }
 
-const QPointF &Link::LinkBinTree::getPoint(uint16_t idx) const
+template<typename Index,typename Access>
+std::tuple<GridPoint,GridPoint> Link::BasicLinkBinTree<Index,Access>::getBounds() const noexcept
 {
-    if( idx >= nodes.size() )
-        throw("index out of range");
-
-    if( nodes[idx].isEmpty() )
-        throw("accesing to an invalid (empty/unused) node");
-
-    return nodes[idx].point;
+    if( !bounds.valid )
+        updateBounds();
+    return {GridPoint(bounds.side[left] ,bounds.side[top]),
+            GridPoint(bounds.side[right],bounds.side[bottom])};
 }
 
-uint16_t Link::LinkBinTree::length() const noexcept
+template<typename Index,typename Access>
+void Link::BasicLinkBinTree<Index,Access>::invalidateSegments() const noexcept
 {
-    uint16_t count = 0;
-    for( const auto& node : nodes )
-        if( !node.isEmpty() )
-            count++;
-    return count;
+    segmentKernel.invalidate();
+    segmentGrid.invalidate();
 }
 
-void Link::LinkBinTree::resetChildIter(uint16_t parentIdx) noexcept
+template<typename Index,typename Access>
+bool Link::BasicLinkBinTree<Index,Access>::simplifyRootNode() noexcept
 {
-    if( parentIdx >= nodes.size() )
+    if( childrenCount(rootIdx) != 2 )
+        return false;
+    const auto first  = firstChild[rootIdx];
+    const auto second = nextSibling[first];
+    if( belongsToLine(first,second,getPoint<UncheckedAccess>(rootIdx)) )
     {
-        iterChildIdx = invalid_index;
-        return;
+        prev[first]   = invalid_index;
+        parent[first] = invalid_index;
+        nextSibling[first] = invalid_index;
+        auto childIdx = firstChild[first];
+        if( childIdx != invalid_index )
+        {
+            while( nextSibling[childIdx] != invalid_index )
+                childIdx = nextSibling[childIdx];
+            nextSibling[childIdx] = second;
+        }
+        else
+        {
+            childIdx = first;
+            firstChild[childIdx] = second;
+        }
+        prev[second]   = childIdx;
+        parent[second] = first;
+        childCount[first]++;
+        releaseNode(rootIdx);
+        rootIdx = first;
+        return true;
     }
-    iterChildIdx = nodes[parentIdx].firstChildIdx;
-}
-
-uint16_t Link::LinkBinTree::childIter() noexcept
-{
-    if( iterChildIdx >= nodes.size() )
-        return invalid_index;
-
-    if( nodes[iterChildIdx].isEmpty() )
-        return invalid_index;
-
-    uint16_t childIdx = iterChildIdx;
-    iterChildIdx = nodes[childIdx].parentNextChildIdx;
-    return childIdx;
+    return false;
 }
 
-void Link::LinkBinTree::resetSubTreeIterator(uint16_t startIdx) noexcept
+template<typename Index,typename Access>
+void Link::BasicLinkBinTree<Index,Access>::showNodes() const noexcept
 {
-    if( startIdx >= nodes.size() )
-    {
-        iterSubTreeStart = invalid_index;
-        iterSubTreeIdx   = invalid_index;
-        return;
-    }
-    if( nodes[startIdx].isEmpty() )
+    for( Index idx=0 ; idx<x.size() ; idx++ )
     {
-        iterSubTreeStart = invalid_index;
-        iterSubTreeIdx   = invalid_index;
-        return;
+        if( isEmpty(idx) )
+            qDebug() << "empty";
+        else
+        {
+            QString left = "X";
+            if( firstChild[idx] != invalid_index )
+                left = QString::number(firstChild[idx]);
+            QString right = "X";
+            if( nextSibling[idx] != invalid_index )
+                right = QString::number(nextSibling[idx]);
+            QString parent = "X";
+            if( prev[idx] != invalid_index )
+                parent = QString::number(prev[idx]);
+            QString port = "";
+            if( auto nodePort = getPort(idx) )
+                port = nodePort->getName();
+            qDebug() << idx << ": " << getPoint<UncheckedAccess>(idx).toScene() << parent << left << right << port;
+        }
     }
-    iterSubTreeStart = startIdx;
-    iterSubTreeIdx   = startIdx;
 }
 
-uint16_t Link::LinkBinTree::iterateSubTree() noexcept
+template<typename Index,typename Access>
+bool Link::BasicLinkBinTree<Index,Access>::checkInvariants() const noexcept
 {
-    if( iterSubTreeIdx == invalid_index )
-        return invalid_index;
-
-    auto idx = iterSubTreeIdx;
-    if( nodes[iterSubTreeIdx].firstChildIdx != invalid_index )
+    const auto size = x.size();
+    if( rootIdx >= size || isEmpty(rootIdx) )
     {
-        iterSubTreeIdx = nodes[iterSubTreeIdx].firstChildIdx;
+        qDebug() << "invalid root" << rootIdx;
+        return false;
     }
-    else if( nodes[iterSubTreeIdx].parentNextChildIdx != invalid_index &&
-             iterSubTreeIdx != iterSubTreeStart )
+    if( prev[rootIdx] != invalid_index || parent[rootIdx] != invalid_index )
     {
-        iterSubTreeIdx = nodes[iterSubTreeIdx].parentNextChildIdx;
+        qDebug() << "root" << rootIdx << "has a prev/parent node";
+        return false;
     }
-    else
+    //the tree is walked from the root, the steps are bounded by the storage
+    //size so a cycle in the links can not hang the check
+    size_t reached = 0;
+    std::vector<Index> pending = {rootIdx};
+    while( !pending.empty() )
     {
-        while( iterSubTreeIdx != iterSubTreeStart )
-            if( (!isParent(nodes[iterSubTreeIdx].prevNode,iterSubTreeIdx) ||
-                   nodes[nodes[iterSubTreeIdx].prevNode].parentNextChildIdx == invalid_index) )
+        const auto idx = pending.back();
+        pending.pop_back();
+        if( ++reached > size )
+        {
+            qDebug() << "cycle in the tree links";
+            return false;
+        }
+        Index count = 0;
+        auto prevIdx = idx;
+        for( auto childIdx = firstChild[idx] ; childIdx != invalid_index ; childIdx = nextSibling[childIdx] )
+        {
+            if( childIdx >= size || isEmpty(childIdx) || count >= size )
             {
-                iterSubTreeIdx = nodes[iterSubTreeIdx].prevNode;
+                qDebug() << "node" << idx << "links to an invalid child" << childIdx;
+                return false;
             }
-            else
-                break;
-        if( iterSubTreeIdx == iterSubTreeStart )
-            iterSubTreeIdx = invalid_index;
-        else
+            if( prev[childIdx] != prevIdx )
+            {
+                qDebug() << "node" << childIdx << "prev is" << prev[childIdx] << "instead of" << prevIdx;
+                return false;
+            }
+            if( parent[childIdx] != idx )
+            {
+                qDebug() << "node" << childIdx << "parent is" << parent[childIdx] << "instead of" << idx;
+                return false;
+            }
+            pending.push_back(childIdx);
+            prevIdx = childIdx;
+            count++;
+        }
+        if( childCount[idx] != count )
         {
-            if( isParent(nodes[iterSubTreeIdx].prevNode,iterSubTreeIdx) &&
-                nodes[nodes[iterSubTreeIdx].prevNode].parentNextChildIdx != invalid_index &&
-                nodes[iterSubTreeIdx].prevNode != iterSubTreeStart )
-                iterSubTreeIdx = nodes[nodes[iterSubTreeIdx].prevNode].parentNextChildIdx;
-            else
-                if( nodes[iterSubTreeIdx].prevNode != iterSubTreeStart )
-                    iterSubTreeIdx = nodes[nodes[iterSubTreeIdx].prevNode].parentNextChildIdx;
-                else
-                    iterSubTreeIdx = invalid_index;
+            qDebug() << "node" << idx << "childCount is" << childCount[idx] << "instead of" << count;
+            return false;
         }
     }
-    return idx;
-}
-
-void Link::LinkBinTree::resetIterator(IterPointers *pointers) const noexcept
-{
-    if( pointers == nullptr )
-    {
-        iterPointers.iterStart = rootIdx;
-        pointers = &iterPointers;
-    }
-    uint16_t &iterParent = pointers->iterParent;
-    uint16_t &iterChild  = pointers->iterChild;
-    uint16_t &iterStart  = pointers->iterStart;
-    if( iterStart == invalid_index )
+    if( reached != liveCount )
     {
-        iterParent = rootIdx;
-        iterStart  = iterParent;
+        qDebug() << reached << "nodes reached from the root, liveCount is" << liveCount;
+        return false;
     }
-    else
+    size_t released = 0;
+    for( auto idx = freeHead ; idx != invalid_index ; idx = firstChild[idx] )
     {
-        if( iterStart >= nodes.size() )
+        if( idx >= size || !isEmpty(idx) || ++released > size )
         {
-            iterParent = invalid_index;
-            iterChild  = invalid_index;
-            return;
+            qDebug() << "invalid node" << idx << "in the free list";
+            return false;
         }
-        else
-            iterParent = iterStart;
     }
-    iterChild  = nodes[iterParent].firstChildIdx;
+    if( released != size-liveCount )
+    {
+        qDebug() << released << "nodes in the free list, expected" << size-liveCount;
+        return false;
+    }
+    return true;
 }
 
-std::optional<std::tuple<const QPointF&,const QPointF&>>
-Link::LinkBinTree::iterate(IterPointers *pointers) const noexcept
+template<typename Index,typename Access>
+void Link::BasicLinkBinTree<Index,Access>::showIteration(Index startIdx) const noexcept
 {
-    if( auto indexs = iterateIdx(pointers) )
+    for( auto[fromIdx,toIdx] : segments(startIdx) )
     {
-        auto[from,to] = indexs.value();
-        return {{nodes[from].point,nodes[to].point}};
+        auto from = getPoint<UncheckedAccess>(fromIdx);
+        auto to   = getPoint<UncheckedAccess>(toIdx);
+        qDebug() << fromIdx << "->" << toIdx << "(" << from.toScene() << "->" << to.toScene() << ")";
     }
-    return {};
 }
 
-std::optional<std::tuple<uint16_t,uint16_t>>
-Link::LinkBinTree::iterateIdx(Link::LinkBinTree::IterPointers *pointers) const noexcept
+template<typename Index,typename Access>
+void Link::BasicLinkBinTree<Index,Access>::showSubTreeIterations(Index startIdx) const noexcept
 {
-    if( pointers == nullptr )
-        pointers = &iterPointers;
-    uint16_t &iterParent = pointers->iterParent;
-    uint16_t &iterChild  = pointers->iterChild;
-    uint16_t &iterStart  = pointers->iterStart;
-    if( iterParent == invalid_index || iterChild == invalid_index )
-        return {};
-    const auto from = iterParent;
-    const auto to   = iterChild;
+    qDebug() << "Sub Tree Iterations:";
+    for( auto idx : subtree(startIdx) )
+        qDebug() << idx;
+}
 
-    //iterChild and iterParent moves down if iterChild has children
-    if( nodes[iterChild].firstChildIdx != invalid_index )
+template<typename Index,typename Access>
+Index Link::BasicLinkBinTree<Index,Access>::createNode(const GridPoint &pos,
+                                       Index parentIdx,
+                                       Index prevIdx,
+                                       Index firstChildIdx,
+                                       Index nextSiblingIdx) noexcept
+{
+    const Index count = firstChildIdx == invalid_index ? 0 : 1;
+    //reuse the last released node if there is one
+    if( auto idx = freeHead; idx != invalid_index )
     {
-        iterParent = iterChild;
-        iterChild  = nodes[iterChild].firstChildIdx;
+        freeHead = firstChild[idx];
+        setNode(idx,pos,parentIdx,prevIdx,firstChildIdx,nextSiblingIdx);
+        childCount[idx] = count;
+        liveCount++;
+        growBounds(idx);
+        invalidateSegments();
+        return idx;
     }
-    //iterChild moves down (iterParent does not move) if iterChild
-    //does not have childrens
-    else if( nodes[iterChild].parentNextChildIdx != invalid_index )
+    //invalid_index can not be used as a node index
+    if( x.size() >= invalid_index )
+        return invalid_index;
+    //creates a new node
+    x.push_back(pos.x);
+    y.push_back(pos.y);
+    prev.push_back(prevIdx);
+    firstChild.push_back(firstChildIdx);
+    nextSibling.push_back(nextSiblingIdx);
+    parent.push_back(parentIdx);
+    childCount.push_back(count);
+    liveCount++;
+    growBounds(Index(x.size()-1));
+    invalidateSegments();
+    return Index(x.size()-1);
+}
+
+template<typename Index,typename Access>
+void Link::BasicLinkBinTree<Index,Access>::setNode(Index idx,
+                                const GridPoint &pos,
+                                Index parentIdx,
+                                Index prevIdx,
+                                Index firstChildIdx,
+                                Index nextSiblingIdx) noexcept
+{
+    x[idx]           = pos.x;
+    y[idx]           = pos.y;
+    parent[idx]      = parentIdx;
+    prev[idx]        = prevIdx;
+    firstChild[idx]  = firstChildIdx;
+    nextSibling[idx] = nextSiblingIdx;
+}
+
+template<typename Index,typename Access>
+void Link::BasicLinkBinTree<Index,Access>::releaseNode(Index idx) noexcept
+{
+    if( isEmpty(idx) )
+        return;
+    if( auto port = getPort(idx) )
     {
-        iterChild = nodes[iterChild].parentNextChildIdx;
+        port->connectionLink.link    = nullptr;
+        port->connectionLink.nodeIdx = LinkBinTree::invalid_index;
+        port->getParent()->portConnectionChanged();
+        setPort(idx,nullptr);
     }
-    //if iterParent has parent child, then iterChild jumps branch
-    //to that child, and iterParent moves up until find the parent
-    else if( nodes[iterParent].parentNextChildIdx != invalid_index &&
-             iterParent != iterStart )
+    releaseBounds(idx);
+    setNode(idx,GridPoint(empty_coordinate,0),invalid_index,invalid_index,freeHead,invalid_index);
+    childCount[idx] = 0;
+    freeHead = idx;
+    liveCount--;
+    invalidateSegments();
+}
+
+template<typename Index,typename Access>
+void Link::BasicLinkBinTree<Index,Access>::growBounds(Index idx) const noexcept
+{
+    if( !bounds.valid )
+        return;
+    if( x[idx] < bounds.side[left] )
     {
-        iterChild = nodes[iterParent].parentNextChildIdx;
-        //iterParent moves up until find the parent of iterChild
-        while( !prevNodeIsParent(iterParent) )
-            iterParent = nodes[iterParent].prevNode;
-        iterParent = nodes[iterParent].prevNode;
+        bounds.side[left]   = x[idx];
+        bounds.holder[left] = idx;
     }
-    else
+    if( y[idx] < bounds.side[top] )
     {
-        //if iterParent has not parent childs, then it should move up
-        //until find a node with a parent child different from itself
-        //(the parent child must be different to iterParent), or reaching
-        //the iterStart
-        while( iterParent != iterStart )
-        {
-            if( prevNodeIsParent(iterParent) &&
-                    nodes[nodes[iterParent].prevNode].parentNextChildIdx != invalid_index)
-            {
-                //iterChild jumps branch
-                iterParent = nodes[iterParent].prevNode;
-                iterChild  = nodes[iterParent].parentNextChildIdx;
-                //iterParent moves up until find the parent of iterChild
-                while( !prevNodeIsParent(iterParent) )
-                {
-                    if( iterParent != iterStart )
-                        iterParent = nodes[iterParent].prevNode;
-                    else
-                        return {{from,to}};
-                        //goto out;
-                }
-                iterParent = nodes[iterParent].prevNode;
-                return {{from,to}};
-            }
-            else
-                //iterParent move up
-                iterParent = nodes[iterParent].prevNode;
-        }
-//        out:
-        if( iterParent == iterStart )
-        {
-            iterParent = invalid_index;
-            iterChild  = invalid_index;
-        }
+        bounds.side[top]   = y[idx];
+        bounds.holder[top] = idx;
     }
-    return {{from,to}};
-}
-
-void Link::LinkBinTree::showNodes() const noexcept
-{
-    for( uint16_t idx=0 ; idx<nodes.size() ; idx++ )
+    if( x[idx] > bounds.side[right] )
     {
-        if( nodes[idx].isEmpty() )
-            qDebug() << "empty";
-        else
-        {
-            QString left = "X";
-            if( nodes[idx].firstChildIdx != invalid_index )
-                left = QString::number(nodes[idx].firstChildIdx);
-            QString right = "X";
-            if( nodes[idx].parentNextChildIdx != invalid_index )
-                right = QString::number(nodes[idx].parentNextChildIdx);
-            QString parent = "X";
-            if( nodes[idx].prevNode != invalid_index )
-                parent = QString::number(nodes[idx].prevNode);
-            QString port = "";
-            if( nodes[idx].connectionPort.port != nullptr )
-                port = nodes[idx].connectionPort.port->name;
-            qDebug() << idx << ": " << nodes[idx].point << parent << left << right << port;
-        }
+        bounds.side[right]   = x[idx];
+        bounds.holder[right] = idx;
     }
-}
-
-void Link::LinkBinTree::showIteration(uint16_t startIdx) noexcept
-{
-    IterPointers iterPointers(startIdx);
-    resetIterator(&iterPointers);
-    while( auto points = iterateIdx(&iterPointers) )
+    if( y[idx] > bounds.side[bottom] )
     {
-        auto[fromIdx,toIdx] = points.value();
-        auto from = nodes[fromIdx].point;//findPoint(p1);
-        auto to   = nodes[toIdx].point;//findPoint(p2);
-        qDebug() << fromIdx << "->" << toIdx << "(" << from << "->" << to << ")";
+        bounds.side[bottom]   = y[idx];
+        bounds.holder[bottom] = idx;
     }
 }
 
-void Link::LinkBinTree::showSubTreeIterations(uint16_t startIdx) noexcept
+template<typename Index,typename Access>
+void Link::BasicLinkBinTree<Index,Access>::moveBounds(Index idx,const GridPoint &point) noexcept
 {
-    qDebug() << "Sub Tree Iterations:";
-    resetSubTreeIterator(startIdx);
-    uint16_t idx;
-    do
-    {
-        idx = iterateSubTree();
-        if( idx != invalid_index )
-            qDebug() << idx;
-    }
-    while( idx != invalid_index );
+    if( !bounds.valid )
+        return;
+    //if the node holds a side and moves inwards, other node may be the
+    //new holder of the side
+    if( (bounds.holder[left]   == idx && point.x > bounds.side[left])  ||
+        (bounds.holder[top]    == idx && point.y > bounds.side[top])   ||
+        (bounds.holder[right]  == idx && point.x < bounds.side[right]) ||
+        (bounds.holder[bottom] == idx && point.y < bounds.side[bottom]) )
+        bounds.valid = false;
 }
 
-uint16_t Link::LinkBinTree::nextEmptyNode(uint16_t startIdx) const noexcept
+template<typename Index,typename Access>
+void Link::BasicLinkBinTree<Index,Access>::releaseBounds(Index idx) noexcept
 {
-    for( ; startIdx < nodes.size() ; ++startIdx )
-        if( nodes[startIdx].isEmpty() )
-            return startIdx;
-    return invalid_index;
+    for( auto holder : bounds.holder )
+        if( holder == idx )
+            bounds.valid = false;
 }
 
-uint16_t Link::LinkBinTree::createNode(const QPointF &pos,
-                                       uint16_t prevNode,
-                                       uint16_t firstChildIdx,
-                                       uint16_t parentNextChildIdx) noexcept
+template<typename Index,typename Access>
+void Link::BasicLinkBinTree<Index,Access>::updateBounds() const noexcept
 {
-    auto idx = nextEmptyNode();
-    //return the first empty node if there is one
-    if( idx != invalid_index )
-    {
-        nodes[idx].setData(pos,prevNode,firstChildIdx,parentNextChildIdx);
-        return idx;
-    }
-    //creates an empty node
-    nodes.reserve(nodes.size()+3);
-    nodes.emplace_back(pos,prevNode,firstChildIdx,parentNextChildIdx);
-    return uint16_t(nodes.size()-1);
+    bounds.side[left]   = bounds.side[right]  = x[rootIdx];
+    bounds.side[top]    = bounds.side[bottom] = y[rootIdx];
+    std::fill(std::begin(bounds.holder),std::end(bounds.holder),rootIdx);
+    bounds.valid = true;
+    for( Index idx=0 ; idx<x.size() ; idx++ )
+        if( !isEmpty(idx) )
+            growBounds(idx);
 }
 
-bool Link::LinkBinTree::simplifyAlignedNode(uint16_t targetIdx) noexcept
+template<typename Index,typename Access>
+bool Link::BasicLinkBinTree<Index,Access>::simplifyAlignedNode(Index targetIdx) noexcept
 {
     //simplification can be applied only to nodes that are located in
     //between two other nodes and are not jointnodes
@@ -536,236 +548,196 @@ bool Link::LinkBinTree::simplifyAlignedNode(uint16_t targetIdx) noexcept
         return false;
     if( isMiddleOfLine(targetIdx) )
     {
-        auto prevChildIdx = nodes[targetIdx].parentNextChildIdx;
-        auto next = nodes[targetIdx].firstChildIdx;
-        auto prev = nodes[targetIdx].prevNode;
-        nodes[next].parentNextChildIdx = prevChildIdx;
-        nodes[next].prevNode = prev;
-        if( isParent(prev,targetIdx) )
-            nodes[prev].firstChildIdx = next;
+        auto prevChildIdx = nextSibling[targetIdx];
+        auto next = firstChild[targetIdx];
+        auto prevIdx = prev[targetIdx];
+        //next takes the place of targetIdx in the children of its parent
+        nextSibling[next] = prevChildIdx;
+        prev[next]   = prevIdx;
+        parent[next] = parent[targetIdx];
+        if( isParent(prevIdx,targetIdx) )
+            firstChild[prevIdx] = next;
         else
-            nodes[prev].parentNextChildIdx = next;
-        if( prevChildIdx != LinkBinTree::invalid_index )
-            nodes[prevChildIdx].prevNode = next;
-        nodes[targetIdx].makeEmpty();
+            nextSibling[prevIdx] = next;
+        if( prevChildIdx != invalid_index )
+            prev[prevChildIdx] = next;
+        releaseNode(targetIdx);
         return true;
     }
     return false;
 }
 
-bool Link::LinkBinTree::isParent(uint16_t parentIdx, uint16_t childIdx) const noexcept
-{
-    return nodes[parentIdx].firstChildIdx == childIdx;
-}
-
-bool Link::LinkBinTree::prevNodeIsParent(uint16_t childIdx) const noexcept
+template<typename Index,typename Access>
+bool Link::BasicLinkBinTree<Index,Access>::isParent(Index parentIdx, Index childIdx) const noexcept
 {
-    auto prev = nodes[childIdx].prevNode;
-    return isParent(prev,childIdx);//nodes[prev].firstChildIdx == childIdx;
+    return firstChild[parentIdx] == childIdx;
 }
 
-bool Link::LinkBinTree::isJointNode(uint16_t targetIdx) const noexcept
+template<typename Index,typename Access>
+bool Link::BasicLinkBinTree<Index,Access>::isJointNode(Index targetIdx) const noexcept
 {
-    if( auto childIdx = nodes[targetIdx].firstChildIdx; childIdx != invalid_index )
-        if( nodes[childIdx].parentNextChildIdx != invalid_index )
-            return true;
-    return false;
+    return childCount[targetIdx] > 1;
 }
 
-std::optional<std::tuple<uint16_t, uint16_t>>
-Link::LinkBinTree::isOnTrajectory(const QPointF &point) const noexcept
+template<typename Index,typename Access>
+std::optional<std::tuple<Index, Index>>
+Link::BasicLinkBinTree<Index,Access>::isOnTrajectory(const GridPoint &point) const noexcept
 {
-    IterPointers iterPointers;
-    resetIterator(&iterPointers);
-    while( auto points = iterateIdx(&iterPointers) )
+    const auto &kernel = getSegmentKernel();
+    if( kernel.size() < gridMinSegments )
     {
-        auto[idxP1,idxP2] = points.value();
-        auto p1 = nodes[idxP1].point;
-        auto p2 = nodes[idxP2].point;
-        auto[minx,maxx] = std::minmax(p1.x(),p2.x());
-        auto[miny,maxy] = std::minmax(p1.y(),p2.y());
-
-        //the rectangle with top-left = p1, and botton-right = p2 will be the working area
-        //and the point should be inside this rectangle, if not, then point is not on the
-        //trajectory between p1 and p2
-        if( !(point.x() < minx || point.x() > maxx || point.y() < miny || point.y() > maxy) )
-        {
-            //if point is exactly a node, return the index of that node and invalid_index
-            if( p1 == point )
-                return {{idxP1,invalid_index}};
-            if( p2 == point )
-                return {{invalid_index,idxP2}};
-
-            //now checks if point is on the trajectory joining p1 and p2
-            auto dx = p2.x()-p1.x();
-            //corner case: the line is vertical (ie, dx = 0)
-            if( dx == 0.0 && equals(point.x(),p1.x()) )
-                return {{idxP1,idxP2}};
-            else
-            {
-                //the line is not vertical.
-                //now we compute the coefficients of the line joining p1 and p2:
-                // y = a*x + b
-                auto a = (p2.y()-p1.y())/dx;
-                auto b = -a*p1.x()+p1.y();
-                //point is on the line if: point.y == a*point.x + b
-                if( equals( point.y() , a*point.x()+b ) )
-                    return {{idxP1,idxP2}};
-            }
-        }
+        //short links: all the segments are tested at once
+        if( auto segment = kernel.findSegmentAt(point); segment >= 0 )
+            return belongsToLine(kernel.fromIdx(size_t(segment)),
+                                 kernel.toIdx(size_t(segment)),
+                                 point);
+        return {};
     }
+    //only the segments crossing the cell of point can contain it
+    for( const auto &segment : getSegmentGrid().segmentsAt(point.toPointF()) )
+        if( auto idx = belongsToLine(segment.from,segment.to,point) )
+            return idx;
     return {};
 }
 
-std::optional<std::tuple<uint16_t, uint16_t>>
-Link::LinkBinTree::isOnTrajectory(const QRectF &rect) const noexcept
+template<typename Index,typename Access>
+std::optional<std::tuple<Index, Index>>
+Link::BasicLinkBinTree<Index,Access>::isOnTrajectory(const GridPoint &topLeft,
+                                                     const GridPoint &bottomRight) const noexcept
 {
-    IterPointers iterPointers;
-    resetIterator(&iterPointers);
-    while( auto points = iterateIdx(&iterPointers) )
+    auto inside = [&](const GridPoint &p)
     {
-        auto[idxP1,idxP2] = points.value();
-        auto p1 = nodes[idxP1].point;
-        auto p2 = nodes[idxP2].point;
+        return p.x >= topLeft.x && p.x <= bottomRight.x && p.y >= topLeft.y && p.y <= bottomRight.y;
+    };
+    const GridPoint corners[4] = {topLeft,
+                                  GridPoint(bottomRight.x,topLeft.y),
+                                  bottomRight,
+                                  GridPoint(topLeft.x,bottomRight.y)};
+    getSegmentGrid().segmentsIn(QRectF(topLeft.toPointF(),bottomRight.toPointF()),rectCandidates);
+    for( const auto &segment : rectCandidates )
+    {
+        const auto idxP1 = segment.from;
+        const auto idxP2 = segment.to;
+        const auto p1 = getPoint<UncheckedAccess>(idxP1);
+        const auto p2 = getPoint<UncheckedAccess>(idxP2);
 
-        if( rect.contains(p1) && rect.contains(p2) )
+        if( inside(p1) && inside(p2) )
             return {{idxP1,idxP2}};
-        if( rect.contains(p1) )
+        if( inside(p1) )
             return {{idxP1,invalid_index}};
-        if( rect.contains(p2) )
+        if( inside(p2) )
             return {{invalid_index,idxP2}};
 
-        //if( QRectF(p1,p2).contains(rect) )
+        //the segment crosses the rect unless their bounding boxes are apart
+        //or the four corners are strictly on the same side of its line
+        //(the cross products are exact, see GridPoint)
+        if( std::max(p1.x,p2.x) < topLeft.x || std::min(p1.x,p2.x) > bottomRight.x ||
+            std::max(p1.y,p2.y) < topLeft.y || std::min(p1.y,p2.y) > bottomRight.y )
+            continue;
+        int left = 0;
+        int right = 0;
+        for( const auto &corner : corners )
         {
-            auto point = rect.center();
-            //now checks if point is on the trajectory joining p1 and p2
-            auto dx = p2.x()-p1.x();
-            //corner case: the line is vertical (ie, dx = 0)
-            if( dx == 0.0 && equals(point.x(),p1.x(),rect.width()/2.0) )
-            {
-                const auto[miny,maxy] = std::minmax(p1.y(),p2.y());
-                if( point.y()+rect.height()/2.0 <= maxy && point.y()-rect.height()/2.0 >= miny )
-                    return {{idxP1,idxP2}};
-            }
-            else
-            {
-                //the line is not vertical.
-                //now we compute the coefficients of the line joining p1 and p2:
-                // y = a*x + b
-                auto a = (p2.y()-p1.y())/dx;
-                auto b = -a*p1.x()+p1.y();
-                //point is on the line if: point.y == a*point.x + b
-                if( equals( point.y() , a*point.x()+b , rect.height()/2.0 ) )
-                    return {{idxP1,idxP2}};
-            }
+            const auto side = GridPoint::cross(p1,p2,corner);
+            left  += side > 0;
+            right += side < 0;
         }
+        if( left != 4 && right != 4 )
+            return {{idxP1,idxP2}};
     }
     return {};
 }
 
-std::optional<std::tuple<uint16_t,uint16_t>>
-Link::LinkBinTree::isMiddleOfLine(uint16_t targetIdx) const noexcept
+template<typename Index,typename Access>
+std::optional<std::tuple<Index,Index>>
+Link::BasicLinkBinTree<Index,Access>::isMiddleOfLine(Index targetIdx) const noexcept
 {
     auto parentIdx = getParent(targetIdx);
-    auto childIdx = nodes[targetIdx].firstChildIdx;
+    auto childIdx = firstChild[targetIdx];
     if( parentIdx == invalid_index || childIdx == invalid_index )
         return {};
 
-    auto point = nodes[targetIdx].point;
-    auto p1 = nodes[parentIdx].point;
-    auto p2 = nodes[childIdx].point;
-    auto[minx,maxx] = std::minmax(p1.x(),p2.x());
-    auto[miny,maxy] = std::minmax(p1.y(),p2.y());
-    if( !(point.x() < minx || point.x() > maxx || point.y() < miny || point.y() > maxy) )
-    {
-        //if point is exactly a node, return the index of that node and invalid_index
-        if( p1 == point )
-            return {{parentIdx,invalid_index}};
-        if( p2 == point )
-            return {{invalid_index,childIdx}};
-
-        //now checks if point is on the trajectory joining p1 and p2
-        auto dx = p2.x()-p1.x();
-        //corner case: the line is vertical (ie, dx = 0)
-        if( dx == 0.0 && equals(point.x(),p1.x()) )
-            return {{parentIdx,childIdx}};
-        else
-        {
-            //the line is not vertical.
-            //now we compute the coefficients of the line joining p1 and p2:
-            // y = a*x + b
-            auto a = (p2.y()-p1.y())/dx;
-            auto b = -a*p1.x()+p1.y();
-            //point is on the line if: point.y == a*point.x + b
-            if( equals( point.y() , a*point.x()+b ) )
-                return {{parentIdx,childIdx}};
-        }
-    }
-    return {};
+    return belongsToLine(parentIdx,childIdx,getPoint<UncheckedAccess>(targetIdx));
 }
 
-bool Link::LinkBinTree::isBetweenTwoNodes(uint16_t targetIdx) const noexcept
+template<typename Index,typename Access>
+bool Link::BasicLinkBinTree<Index,Access>::isBetweenTwoNodes(Index targetIdx) const noexcept
 {
-    if( nodes[targetIdx].prevNode      == invalid_index ||
-        nodes[targetIdx].firstChildIdx == invalid_index )
+    if( prev[targetIdx]       == invalid_index ||
+        firstChild[targetIdx] == invalid_index )
         return false;
     return true;
 }
 
-std::optional<std::tuple<uint16_t,uint16_t>>
-Link::LinkBinTree::belongsToLine(uint16_t idxP1,
-                                 uint16_t idxP2,
-                                 const QPointF &point) const noexcept
+template<typename Index,typename Access>
+std::optional<std::tuple<Index,Index>>
+Link::BasicLinkBinTree<Index,Access>::belongsToLine(Index idxP1,
+                                 Index idxP2,
+                                 const GridPoint &point) const noexcept
 {
-    auto p1 = nodes[idxP1].point;
-    auto p2 = nodes[idxP2].point;
-    auto[minx,maxx] = std::minmax(p1.x(),p2.x());
-    auto[miny,maxy] = std::minmax(p1.y(),p2.y());
-
-    //the rectangle with top-left = p1, and botton-right = p2 will be the working area
-    //and the point should be inside this rectangle, if not, then point is not on the
-    //trajectory between p1 and p2
-    if( !(point.x() < minx || point.x() > maxx || point.y() < miny || point.y() > maxy) )
+    //same test as the one done in batch by the segment kernel
+    switch( SegmentKernel::testPoint(getPoint<UncheckedAccess>(idxP1),getPoint<UncheckedAccess>(idxP2),point) )
     {
-        //if point is exactly a node, return the index of that node and invalid_index
-        if( p1 == point )
+        case SegmentKernel::Hit::None:
+            break;
+        case SegmentKernel::Hit::First:
             return {{idxP1,invalid_index}};
-        if( p2 == point )
+        case SegmentKernel::Hit::Second:
             return {{invalid_index,idxP2}};
-
-        //now checks if point is on the trajectory joining p1 and p2
-        auto dx = p2.x()-p1.x();
-        //corner case: the line is vertical (ie, dx = 0)
-        if( dx == 0.0 && equals(point.x(),p1.x()) )
+        case SegmentKernel::Hit::Line:
             return {{idxP1,idxP2}};
-        else
-        {
-            //the line is not vertical.
-            //now we compute the coefficients of the line joining p1 and p2:
-            // y = a*x + b
-            auto a = (p2.y()-p1.y())/dx;
-            auto b = -a*p1.x()+p1.y();
-            //point is on the line if: point.y == a*point.x + b
-            if( equals( point.y() , a*point.x()+b ) )
-                return {{idxP1,idxP2}};
-        }
     }
     return {};
 }
 
+template<typename Index,typename Access>
+const SegmentGrid &Link::BasicLinkBinTree<Index,Access>::getSegmentGrid() const
+{
+    updateSegments();
+    return segmentGrid;
+}
+
+template<typename Index,typename Access>
+const SegmentKernel &Link::BasicLinkBinTree<Index,Access>::getSegmentKernel() const
+{
+    updateSegments();
+    return segmentKernel;
+}
+
+template<typename Index,typename Access>
+void Link::BasicLinkBinTree<Index,Access>::updateSegments() const
+{
+    if( segmentKernel.isValid() && segmentGrid.isValid() )
+        return;
+    segmentKernel.clear();
+    //a cell of the segment grid is a cell of the scene grid
+    segmentGrid.clear(GridPoint::subdivisions);
+    uint32_t seq = 0;
+    for( auto[idxP1,idxP2] : segments() )
+    {
+        const auto p1 = getPoint<UncheckedAccess>(idxP1);
+        const auto p2 = getPoint<UncheckedAccess>(idxP2);
+        segmentKernel.append(idxP1,idxP2,p1,p2);
+        segmentGrid.insert(seq++,idxP1,idxP2,p1.toPointF(),p2.toPointF());
+    }
+    segmentKernel.finish();
+    segmentGrid.finish();
+}
+
 //--------------------------------------
 //------ Link
 Link::Link(const QPointF &startPos)
     : //points(startPos),
-      tree(startPos)
+      tree(GridPoint::fromScene(startPos))
 {
 
 //    setFlags(QGraphicsItem::ItemIsMovable);
-    auto effect = new QGraphicsDropShadowEffect;
-    effect->setOffset(2, 2);
-    effect->setBlurRadius(15);
-    effect->setColor(StyleLink::shadowColor);
-    setGraphicsEffect(effect);
+}
+
+Link::~Link()
+{
+    //the scene does not notify the items deleted while in it
+    Scene::itemDeleted(this);
 }
 
 //Link::Link(const Link &l)
@@ -783,116 +755,81 @@ void Link::paint(QPainter *painter,
 {
     Q_UNUSED(option)
     Q_UNUSED(widget)
-    //points.resetIterator();
-    //points.show();
-    painter->setPen(QPen(QBrush(StyleLink::normalColor),
-                         qreal(StyleLink::width),
-                         StyleLink::normalLine,
-                         StyleLink::normalCap));
-    painter->setFont(StyleText::blockHintFont);
-
-    tree.resetIterator();
-    while( auto idx = tree.iterateIdx() )
+    if( !render.valid )
+        updateRenderCache();
+    const auto tier = StyleLevelOfDetail::tier(painter);
+    if( tier == StyleLevelOfDetail::Tier::Flat )
     {
-        auto[from,to] = idx.value();
-        //draw line:
-        painter->drawLine(tree[from],tree[to]);
-        //draw node:
-        if( tree.childrenCount(to) > 1 )
-        painter->drawEllipse(tree[to],2,2);
-
-        //[DEBUG] draw node index:
-        #define LINK_DEBUG
-        #ifdef LINK_DEBUG
-        painter->save();
-        if( from == tree.rootIdx )
-            painter->setPen(QPen(QBrush(Qt::magenta),
-                                 qreal(StyleLink::width),
-                                 StyleLink::normalLine,
-                                 StyleLink::normalCap));
-        else
-            painter->setPen(QPen(QBrush(Qt::red),
-                                 qreal(StyleLink::width),
-                                 StyleLink::normalLine,
-                                 StyleLink::normalCap));
-        painter->drawText(tree[from],QString::number(from)+"["+QString::number(tree.childrenCount(from))+"]"+"("+QString::number(tree[from].x())+","+QString::number(tree[from].y())+")");
-        if( to == tree.rootIdx )
-            painter->setPen(QPen(QBrush(Qt::magenta),
-                                 qreal(StyleLink::width),
-                                 StyleLink::normalLine,
-                                 StyleLink::normalCap));
-        else
-            painter->setPen(QPen(QBrush(Qt::red),
-                                 qreal(StyleLink::width),
-                                 StyleLink::normalLine,
-                                 StyleLink::normalCap));
-        painter->drawText(tree[to]  ,QString::number(to)  +"["+QString::number(tree.childrenCount(to))  +"]"+"("+QString::number(tree[to].x())  +","+QString::number(tree[to]  .y())+")");
-        painter->restore();
-        #endif
+        painter->setPen(render.flatPen);
+        painter->drawLines(render.lines);
+        return;
     }
-    #ifdef LINK_DEBUG
-    painter->setPen(QPen(QBrush(Qt::blue),
-                         1,
-                         Qt::DashLine,
-                         StyleLink::normalCap));
-    painter->drawRect(boundingRect());
-    #endif
+    ShadowCache::drawLines(painter,render.lines,StyleLink::width,StyleLink::shadowColor);
+    painter->setPen(render.linePen);
+    painter->drawLines(render.lines);
+    if( !render.junctions.isEmpty() )
+    {
+        painter->setPen(render.junctionPen);
+        painter->drawPoints(render.junctions.constData(),render.junctions.size());
+    }
+    if( StyleLink::showDebugInfo && tier == StyleLevelOfDetail::Tier::Full )
+        paintDebugInfo(painter);
 }
 
-std::optional<QPointF> Link::computeMidPoint(const QPointF &startPoint,
-                                             const QPointF &endPoint,
-                                             const Link::LinkPath &linkPath) const noexcept
+std::optional<GridPoint> Link::computeMidPoint(const GridPoint &startPoint,
+                                               const GridPoint &endPoint,
+                                               const Link::LinkPath &linkPath) const noexcept
 {
-    QPointF midp;
+    GridPoint midp;
     switch( linkPath )
     {
         case LinkPath::straight:
             return {};
         case LinkPath::verticalThenHorizontal:
-            midp = QPointF( startPoint.x() , endPoint.y() );
+            midp = GridPoint( startPoint.x , endPoint.y );
             break;
         case LinkPath::horizontalThenVertical:
-            midp = QPointF( endPoint.x() , startPoint.y() );
+            midp = GridPoint( endPoint.x , startPoint.y );
             break;
         case LinkPath::straightThenOrthogonal:
             {
                 auto diffp = startPoint-endPoint;
-                auto diffx = std::abs(diffp.x());
-                auto diffy = std::abs(diffp.y());
+                auto diffx = std::abs(diffp.x);
+                auto diffy = std::abs(diffp.y);
                 if( diffx < diffy )
                 {
-                    if( endPoint.y() > startPoint.y() )
-                        midp = QPointF( endPoint.x() , startPoint.y()+diffx);
+                    if( endPoint.y > startPoint.y )
+                        midp = GridPoint( endPoint.x , startPoint.y+diffx);
                     else
-                        midp = QPointF( endPoint.x() , startPoint.y()-diffx);
+                        midp = GridPoint( endPoint.x , startPoint.y-diffx);
                 }
                 else
                 {
-                    if( endPoint.x() > startPoint.x() )
-                        midp = QPointF( startPoint.x()+diffy , endPoint.y() );
+                    if( endPoint.x > startPoint.x )
+                        midp = GridPoint( startPoint.x+diffy , endPoint.y );
                     else
-                        midp = QPointF( startPoint.x()-diffy , endPoint.y() );
+                        midp = GridPoint( startPoint.x-diffy , endPoint.y );
                 }
             }
             break;
         case LinkPath::orthogonalThenStraight:
             {
                 auto diffp = startPoint-endPoint;
-                auto diffx = std::abs(diffp.x());
-                auto diffy = std::abs(diffp.y());
+                auto diffx = std::abs(diffp.x);
+                auto diffy = std::abs(diffp.y);
                 if( diffx <= diffy )
                 {
-                    if( endPoint.y() < startPoint.y() )
-                        midp = QPointF( startPoint.x() , endPoint.y()+diffx);
+                    if( endPoint.y < startPoint.y )
+                        midp = GridPoint( startPoint.x , endPoint.y+diffx);
                     else
-                        midp = QPointF( startPoint.x() , endPoint.y()-diffx);
+                        midp = GridPoint( startPoint.x , endPoint.y-diffx);
                 }
                 else
                 {
-                    if( endPoint.x() < startPoint.x() )
-                        midp = QPointF( endPoint.x()+diffy , startPoint.y() );
+                    if( endPoint.x < startPoint.x )
+                        midp = GridPoint( endPoint.x+diffy , startPoint.y );
                     else
-                        midp = QPointF( endPoint.x()-diffy , startPoint.y() );
+                        midp = GridPoint( endPoint.x-diffy , startPoint.y );
                 }
             }
             break;
@@ -900,64 +837,103 @@ std::optional<QPointF> Link::computeMidPoint(const QPointF &startPoint,
     return midp;
 }
 
-void Link::updateContainerRect()
+QRectF Link::computeContainerRect() const noexcept
 {
-    auto ptl = tree[tree.rootIdx];
-    auto pbr = tree[tree.rootIdx];
-    for( uint16_t idx=0 ; idx<tree.nodes.size() ; idx++ )
-    {
-        if( tree.nodes[idx].isEmpty() )
-            continue;
+    //the rect is kept normalized (top < bottom), otherwise the
+    //scene index would not be able to locate the link
+    const auto[topLeft,bottomRight] = tree.getBounds();
+    const QPointF margin(StyleGrid::gridSize,StyleGrid::gridSize);
+    return QRectF(topLeft.toScene()-margin,bottomRight.toScene()+margin);
+}
 
-        auto x = tree[idx].x();
-        auto y = tree[idx].y();
-        if( ptl.x() > x )
-            ptl.setX(x);
-        if( ptl.y() < y )
-            ptl.setY(y);
-        if( pbr.x() < x )
-            pbr.setX(x);
-        if( pbr.y() > y )
-            pbr.setY(y);
+void Link::updateGeometry()
+{
+    tree.invalidateSegments();
+    render.valid = false;
+    if( editDepth > 0 )
+    {
+        editPending = true;
+        return;
+    }
+    //the scene must be notified before the bounding rect changes,
+    //so it can remove the link from the index using the old rect
+    //(prepareGeometryChange() also schedules the repaint). Most of the
+    //edits (as the drags of the blocks) do not change the rect, and then
+    //only the repaint is needed. The Scene is told in both cases (its
+    //DensityMap follows the lines)
+    const auto rect = computeContainerRect();
+    if( rect == containerRect )
+        update();
+    else
+    {
+        prepareGeometryChange();
+        containerRect = rect;
     }
-    ptl.setX(ptl.x()-double(StyleGrid::gridSize));
-    ptl.setY(ptl.y()+double(StyleGrid::gridSize));
-    pbr.setX(pbr.x()+double(StyleGrid::gridSize));
-    pbr.setY(pbr.y()-double(StyleGrid::gridSize));
-    containerRect = QRectF(ptl,pbr);
+    Scene::itemGeometryChanged(this);
 }
 
-bool Link::simplifyRootNode() noexcept
+QVariant Link::itemChange(GraphicsItemChange change,const QVariant &value)
 {
-    if( tree.childrenCount(tree.rootIdx) != 2 )
-        return false;
-    const auto first  = tree.nodes[tree.rootIdx].firstChildIdx;
-    const auto second = tree.nodes[first].parentNextChildIdx;
-    if( tree.belongsToLine(first,second,tree[tree.rootIdx]) )
+    Scene::itemChange(this,change);
+    return QGraphicsItem::itemChange(change,value);
+}
+
+void Link::updateRenderCache()
+{
+    render.lines.clear();
+    render.junctions.clear();
+    render.lines.reserve(tree.length());
+    for( auto[from,to] : tree.segments() )
     {
-        tree.nodes[first].prevNode = LinkBinTree::invalid_index;
-        tree.nodes[first].parentNextChildIdx = LinkBinTree::invalid_index;
-        auto childIdx = tree.nodes[first].firstChildIdx;
-        if( childIdx != LinkBinTree::invalid_index )
-        {
-            while( tree.nodes[childIdx].parentNextChildIdx != LinkBinTree::invalid_index )
-                childIdx = tree.nodes[childIdx].parentNextChildIdx;
-            tree.nodes[childIdx].parentNextChildIdx = second;
-        }
-        else
-        {
-            childIdx = first;
-            tree.nodes[childIdx].firstChildIdx = second;
-        }
-        tree.nodes[second].prevNode = childIdx;
-        tree.nodes[tree.rootIdx].makeEmpty();
-        tree.rootIdx = first;
-        return true;
+        //the tree is in grid units
+        const auto p2 = tree.getPoint<UncheckedAccess>(to).toScene();
+        render.lines.append(QLineF(tree.getPoint<UncheckedAccess>(from).toScene(),p2));
+        if( tree.childrenCount(to) > 1 )
+            render.junctions.append(p2);
     }
-    return false;
+    render.linePen = QPen(QBrush(StyleLink::normalColor),
+                          qreal(StyleLink::width),
+                          StyleLink::normalLine,
+                          StyleLink::normalCap);
+    //the junctions are drawn as round points as wide as the circles
+    //(of junctionRadius) that were drawn with the line pen
+    render.junctionPen = QPen(QBrush(StyleLink::normalColor),
+                              qreal(2.0*StyleLink::junctionRadius+StyleLink::width),
+                              Qt::SolidLine,
+                              Qt::RoundCap);
+    //cosmetic (1 pixel at any zoom)
+    render.flatPen = QPen(StyleLink::normalColor,0.0);
+    render.valid = true;
+}
+
+void Link::paintDebugInfo(QPainter *painter) const
+{
+    const QPen rootPen(QBrush(Qt::magenta),
+                       qreal(StyleLink::width),
+                       StyleLink::normalLine,
+                       StyleLink::normalCap);
+    const QPen nodePen(QBrush(Qt::red),
+                       qreal(StyleLink::width),
+                       StyleLink::normalLine,
+                       StyleLink::normalCap);
+    painter->save();
+    painter->setFont(StyleText::blockHintFont);
+    //node index, its children count and its position
+    for( auto idx : tree.subtree(tree.rootIdx) )
+    {
+        const auto p = tree.getPoint<UncheckedAccess>(idx).toScene();
+        painter->setPen(idx == tree.rootIdx ? rootPen : nodePen);
+        painter->drawText(p,QString::number(idx)+"["+QString::number(tree.childrenCount(idx))+"]"+"("+QString::number(p.x())+","+QString::number(p.y())+")");
+    }
+    painter->setPen(QPen(QBrush(Qt::blue),
+                         1,
+                         Qt::DashLine,
+                         StyleLink::normalCap));
+    painter->drawRect(boundingRect());
+    painter->restore();
 }
 
-std::tuple<uint16_t,uint16_t> Link::getGrabbedIndexs(const QPointF &pos) const noexcept
+std::tuple<LinkIndex,LinkIndex> Link::getGrabbedIndexs(const GridPoint &pos) const noexcept
 {
     if( tree.length() < 2 )
         return {LinkBinTree::invalid_index,LinkBinTree::invalid_index};
@@ -965,86 +941,43 @@ std::tuple<uint16_t,uint16_t> Link::getGrabbedIndexs(const QPointF &pos) const n
     //if the line is closer to pos, its indexes will be return, otherwise
     //the pos's indexes will be returned.
 
-    //distances from pos to a node (pdist) and to a line (ldist)
-    auto pdist = qInf();
-    auto ldist = qInf();
+    //distances from pos to the closest node (pdist) and line (ldist),
+    //computed for all the segments at once
+    const auto &kernel = tree.getSegmentKernel();
+    const auto nearest = kernel.nearest(pos);
+    if( nearest.nodeSegment < 0 )
+        return {LinkBinTree::invalid_index,LinkBinTree::invalid_index};
+    const auto pdist = nearest.nodeDist;
+    const auto ldist = nearest.lineDist;
     //index of the node that is closest to pos
-    auto pIdx  = LinkBinTree::invalid_index;
-    //indexes of the line that is closest to pos
+    const auto pIdx  = nearest.nodeIsSecond ? kernel.toIdx(size_t(nearest.nodeSegment))
+                                            : kernel.fromIdx(size_t(nearest.nodeSegment));
+    //indexes of the line that is closest to pos (the line is only taken
+    //into account if the perpendicular from pos falls inside of it)
     auto lIdx1 = LinkBinTree::invalid_index;
     auto lIdx2 = LinkBinTree::invalid_index;
-    QPointF inter;
-
-    LinkBinTree::IterPointers iterPointer;
-    tree.resetIterator(&iterPointer);
-    while( auto idx = tree.iterateIdx(&iterPointer) )
+    if( nearest.lineSegment >= 0 )
     {
-        const auto[from,to] = idx.value();
-        //compute the distances from pos to p1 and p2
-        const auto& p1 = tree.getPoint(from);
-        const auto& p2 = tree.getPoint(to);
-        if( pdist > squareDistance(pos,p1) )
-        {
-            //records the min distance and the index
-            pdist = squareDistance(pos,p1);
-            pIdx  = from;
-        }
-        if( pdist > squareDistance(pos,p2) )
-        {
-            //records the min distance and the index
-            pdist = squareDistance(pos,p2);
-            pIdx  = to;
-        }
-        //now compute the distance from pos to the line
-        //that is formed by p1 and p2.
-        //This distance is taken from the perpendicular line that
-        //connects pos with the target line (formed by p1 and p2)
-        QLineF line(p1,p2);
-        QPointF pp1( pos.x()+line.dy() , pos.y()-line.dx() );
-        QPointF pp2( pos.x()-line.dy() , pos.y()+line.dx() );
-        QLineF pline(pp1,pp2);
-
-        switch( line.intersects(pline,&pp1) )
-        {
-            case QLineF::UnboundedIntersection:
-                //if the unbounded intersection point is part of line then
-                //compute the distance between pos a pp1
-                if( tree.belongsToLine(from,to,pp1) )
-                    if( ldist > squareDistance(pos,pp1) )
-                    {
-                        ldist = squareDistance(pos,pp1);
-                        lIdx1 = from;
-                        lIdx2 = to;
-                        inter = pp1;
-                    }
-                break;
-            case QLineF::BoundedIntersection:
-                if( ldist > squareDistance(pos,pp1) )
-                {
-                    ldist = squareDistance(pos,pp1);
-                    lIdx1 = from;
-                    lIdx2 = to;
-                    inter = pp1;
-                }
-                break;
-            case QLineF::NoIntersection:
-                qDebug() << "********************** this represents a throw (since we are using perpendicular lines, should allways be an interseccion)" << __LINE__;
-                break;
-        }
+        lIdx1 = kernel.fromIdx(size_t(nearest.lineSegment));
+        lIdx2 = kernel.toIdx(size_t(nearest.lineSegment));
     }
+    const auto inter = nearest.lineFoot;
+
     //if no line was selected, then returns the pIdx
     if( lIdx1 == LinkBinTree::invalid_index )
         return {pIdx,LinkBinTree::invalid_index};
 
     //only select the closest line if pos is near the center of the line:
     //Lenght of the line
-    const auto len = squareDistance(tree.getPoint(lIdx1),tree.getPoint(lIdx2));
+    const auto p1  = tree.getPoint(lIdx1).toPointF();
+    const auto p2  = tree.getPoint(lIdx2).toPointF();
+    const auto len = squareDistance(p1,p2);
     //distance from intersecction to nearest extreme
     auto lIdx  = lIdx1;
-    auto edist = squareDistance(inter,tree.getPoint(lIdx1));
-    if( edist > squareDistance(inter,tree.getPoint(lIdx2)) )
+    auto edist = squareDistance(inter,p1);
+    if( edist > squareDistance(inter,p2) )
     {
-        edist = squareDistance(inter,tree.getPoint(lIdx2));
+        edist = squareDistance(inter,p2);
         lIdx = lIdx2;
     }
     if( edist < len*0.04 )  //0.2^2 = 0.04 -> this represents de 20% of the lenght
@@ -1052,7 +985,7 @@ std::tuple<uint16_t,uint16_t> Link::getGrabbedIndexs(const QPointF &pos) const n
         //this means that pos is closer to the extreme (lIdx) than is
         //to the center of the line.
         //Now the closest node (pIdx or lIdx) will be selected
-        if( squareDistance(pos,tree.getPoint(lIdx)) < pdist )
+        if( squareDistance(pos.toPointF(),tree.getPoint(lIdx).toPointF()) < pdist )
             return {lIdx,LinkBinTree::invalid_index};
         return {pIdx,LinkBinTree::invalid_index};
     }
@@ -1061,20 +994,31 @@ std::tuple<uint16_t,uint16_t> Link::getGrabbedIndexs(const QPointF &pos) const n
     return {lIdx1,lIdx2};
 }
 
+const QVector<QLineF> &Link::getLines()
+{
+    if( !render.valid )
+        updateRenderCache();
+    return render.lines;
+}
+
 bool Link::isPartOfLink(const QPointF &point) const noexcept
 {
-    return tree.isOnTrajectory(point).has_value();
+    return tree.isOnTrajectory(GridPoint::fromScene(point)).has_value();
 }
 
 bool Link::isPartOfLink(const QRectF &rect) const noexcept
 {
-    return tree.isOnTrajectory(rect).has_value();
+    const auto normalized = rect.normalized();
+    return tree.isOnTrajectory(GridPoint::fromScene(normalized.topLeft()),
+                               GridPoint::fromScene(normalized.bottomRight())).has_value();
 }
 
-void Link::insertLineAt(const QPointF  &start,
-                        const QPointF  &end,
+void Link::insertLineAt(const QPointF  &sceneStart,
+                        const QPointF  &sceneEnd,
                         const LinkPath &linkPath) noexcept
 {
+    const auto start = GridPoint::fromScene(sceneStart);
+    const auto end   = GridPoint::fromScene(sceneEnd);
     if( tree.length() == 1 )
     {
         if( const auto &validMidPoint = computeMidPoint(start,end,linkPath) )
@@ -1087,9 +1031,7 @@ void Link::insertLineAt(const QPointF  &start,
             idxMid = LinkBinTree::invalid_index;
             idxEnd = tree.appendChild(idxStart,end);
         }
-        updateContainerRect();
-        prepareGeometryChange();
-        update();
+        updateGeometry();
         return;
     }
     if( auto idx = tree.isOnTrajectory(start) )
@@ -1131,28 +1073,27 @@ void Link::insertLineAt(const QPointF  &start,
                 idxEnd = tree.appendChild(idxStart,end);
             }
         }
-        updateContainerRect();
-        prepareGeometryChange();
-        update();
+        updateGeometry();
         return;
     }
 }
 
-void Link::updateLastInsertedLine(const QPointF &end, const Link::LinkPath &linkPath) noexcept
+void Link::updateLastInsertedLine(const QPointF &sceneEnd, const Link::LinkPath &linkPath) noexcept
 {
+    const auto end = GridPoint::fromScene(sceneEnd);
     //if no line was inserted, do nothing
     if( idxStart != LinkBinTree::invalid_index )
     {
-        if( const auto& midp = computeMidPoint(tree[idxStart],end,linkPath) )
+        if( const auto& midp = computeMidPoint(tree.getPoint(idxStart),end,linkPath) )
         {
             //insert midp or update if exists
             if( idxMid != LinkBinTree::invalid_index )
                 //update
-                tree[idxMid] = midp.value();
+                tree.setPoint(idxMid,midp.value());
             else
                 //insert
                 idxMid = tree.insertBefore(idxEnd,midp.value());
-            tree[idxEnd] = end;
+            tree.setPoint(idxEnd,end);
         }
         else
         {
@@ -1160,17 +1101,15 @@ void Link::updateLastInsertedLine(const QPointF &end, const Link::LinkPath &link
             if( idxMid != LinkBinTree::invalid_index )
             {
                 tree.removeSubTree(idxEnd);
-                tree[idxMid] = end;
+                tree.setPoint(idxMid,end);
                 idxEnd = idxMid;
                 idxMid = LinkBinTree::invalid_index;
             }
             else
-                tree[idxEnd] = end;
+                tree.setPoint(idxEnd,end);
         }
 
-        updateContainerRect();
-        prepareGeometryChange();
-        update();
+        updateGeometry();
     }
 }
 
@@ -1179,7 +1118,7 @@ void Link::simplifyLastInsertedLine() noexcept
     if( idxStart == LinkBinTree::invalid_index )
         return;
 
-    if( tree[idxStart] == tree[idxEnd] )
+    if( tree.getPoint(idxStart) == tree.getPoint(idxEnd) )
     {
         if( idxMid != LinkBinTree::invalid_index )
         {
@@ -1188,20 +1127,14 @@ void Link::simplifyLastInsertedLine() noexcept
             idxMid = LinkBinTree::invalid_index;
         }
         else
-        {
-            tree.nodes[idxEnd].makeEmpty();
-            auto prev = tree.nodes[idxEnd].prevNode;
-            if( tree.isParent(prev,idxEnd) )
-                tree.nodes[prev].firstChildIdx = LinkBinTree::invalid_index;
-            else
-                tree.nodes[prev].parentNextChildIdx = LinkBinTree::invalid_index;
-        }
+            //idxEnd is the last appended node (a leaf without next sibling)
+            tree.removeSubTree(idxEnd);
         //tree.simplifyAlignedNode(idxStart);
         goto out;
     }
     if( idxMid != LinkBinTree::invalid_index )
     {
-        if( tree[idxMid] == tree[idxEnd] )
+        if( tree.getPoint(idxMid) == tree.getPoint(idxEnd) )
         {
             //simplifaction is needed
             tree.removeSubTree(idxEnd);
@@ -1209,31 +1142,31 @@ void Link::simplifyLastInsertedLine() noexcept
             idxMid = LinkBinTree::invalid_index;
             goto out;
         }
-        if( tree[idxMid] == tree[idxStart] )
+        if( tree.getPoint(idxMid) == tree.getPoint(idxStart) )
         {
-            auto point = tree[idxEnd];
+            auto point = tree.getPoint(idxEnd);
             tree.removeSubTree(idxEnd);
-            tree[idxMid] = point;
+            tree.setPoint(idxMid,point);
             idxEnd = idxMid;
             idxMid = LinkBinTree::invalid_index;
             goto out;
         }
     }
     out:
-    tree.simplifyAlignedNode(idxStart);
-
     //the idxStart node may be aligned with its parent, and if the parent is
-    //also aligned with its parent, the a simplification can be done
+    //also aligned with its parent, the a simplification can be done.
+    //The parent is taken first since idxStart may be released below
     auto idx = tree.getParent(idxStart);
+    tree.simplifyAlignedNode(idxStart);
     if( idx != LinkBinTree::invalid_index )
         tree.simplifyAlignedNode(idx);
     else
-        simplifyRootNode();
+        tree.simplifyRootNode();
 
+    if( tree.isFragmented() )
+        compact();
 
-    updateContainerRect();
-    prepareGeometryChange();
-    update();
+    updateGeometry();
 }
 
 void Link::removeLastInsertedLine() noexcept
@@ -1244,14 +1177,12 @@ void Link::removeLastInsertedLine() noexcept
         tree.removeSubTree(idxEnd);
     tree.simplifyAlignedNode(idxStart);
     idxStart = LinkBinTree::invalid_index;
-    updateContainerRect();
-    prepareGeometryChange();
-    update();
+    updateGeometry();
 }
 
 void Link::selectArea(const QPainterPath &shape) noexcept
 {
-    //here we could use an IterPointers, but since we only
+    //here we could use tree.subtree(), but since we only
     //need to determine which nodes are contained by shape
     //regardless of relationship between the nodes, we
     //will use a simple for.
@@ -1260,18 +1191,18 @@ void Link::selectArea(const QPainterPath &shape) noexcept
     //NOTE: this logics relies on the correct assigment of "empty"
     //to the nodes that are unused
     selectedIdx.clear();
-    for( uint16_t idx=0 ; idx<tree.nodes.size() ; idx++ )
-        if( !tree.nodes[idx].isEmpty() )
-            if( shape.contains(tree.nodes[idx].point) )
+    for( LinkIndex idx=0 ; idx<tree.storageSize() ; idx++ )
+        if( !tree.isEmpty(idx) )
+            if( shape.contains(tree.getPoint<UncheckedAccess>(idx).toScene()) )
                 selectedIdx.push_back(idx);
 }
 
 void Link::selectAreaFirstItem(const QPainterPath &shape) noexcept
 {
     selectedIdx.clear();
-    for( uint16_t idx=0 ; idx<tree.nodes.size() ; idx++ )
-        if( !tree.nodes[idx].isEmpty() )
-            if( shape.contains(tree.nodes[idx].point) )
+    for( LinkIndex idx=0 ; idx<tree.storageSize() ; idx++ )
+        if( !tree.isEmpty(idx) )
+            if( shape.contains(tree.getPoint<UncheckedAccess>(idx).toScene()) )
             {
                 selectedIdx.push_back(idx);
                 return;
@@ -1280,7 +1211,7 @@ void Link::selectAreaFirstItem(const QPainterPath &shape) noexcept
 
 void Link::selectAreaNearestItem(const QPointF &pos) noexcept
 {
-    auto[idx1,idx2] = getGrabbedIndexs(pos);
+    auto[idx1,idx2] = getGrabbedIndexs(GridPoint::fromScene(pos));
     selectedIdx.clear();
     if( idx1 != LinkBinTree::invalid_index )
         selectedIdx.push_back(idx1);
@@ -1298,34 +1229,32 @@ bool Link::isSelectedAreaMovable() const noexcept
     if( selectedIdx.size() == 0 )
         return false;
     for( const auto idx : selectedIdx )
-        if( tree.nodes[idx].connectionPort.connected )
+        if( tree.getPort(idx) != nullptr )
             return false;
     return true;
 }
 
 bool Link::isConnectedAtPoint(const QPointF &point) const noexcept
 {
-    for( auto &node : tree.nodes )
-        if( node.point == point )
-            return node.connectionPort.connected;
+    const auto gridPoint = GridPoint::fromScene(point);
+    for( LinkIndex idx=0 ; idx<tree.storageSize() ; idx++ )
+        if( !tree.isEmpty(idx) && tree.getPoint<UncheckedAccess>(idx) == gridPoint )
+            return tree.getPort(idx) != nullptr;
     return false;
 }
 
 void Link::displaceSelectedArea(const QPointF &offset) noexcept
 {
+    const auto gridOffset = GridPoint::fromScene(offset);
     for( auto idx : selectedIdx )
-        tree[idx] += offset;
-    updateContainerRect();
-    prepareGeometryChange();
-    update();
+        tree.setPoint(idx,tree.getPoint(idx)+gridOffset);
+    updateGeometry();
 }
 
-void Link::moveSelectedNode(uint16_t nodeIdx,const QPointF &to)
+void Link::moveSelectedNode(LinkIndex nodeIdx,const QPointF &to)
 {
-    tree[nodeIdx] = to;
-    updateContainerRect();
-    prepareGeometryChange();
-    update();
+    tree.setPoint(nodeIdx,GridPoint::fromScene(to));
+    updateGeometry();
 }
 
 void Link::simplifySelectedArea() noexcept
@@ -1333,7 +1262,7 @@ void Link::simplifySelectedArea() noexcept
     if( selectedIdx.size() == 0 )
         return;
     for( auto idx : selectedIdx )
-        if( !tree.nodes[idx].isEmpty() )
+        if( !tree.isEmpty(idx) )
         {
             if( auto parent = tree.getParent(idx); parent != LinkBinTree::invalid_index )
             {
@@ -1347,34 +1276,50 @@ void Link::simplifySelectedArea() noexcept
                 //then the rootIdx should be removed
                 if( tree.childrenCount(idx) == 2 )
                 {
-                    simplifyRootNode();
-                    idx = tree.nodes[tree.rootIdx].firstChildIdx;
+                    tree.simplifyRootNode();
+                    idx = tree.firstChild[tree.rootIdx];
                 }
             }
 
-            tree.resetChildIter(idx);
-            while( true )
-            {
-                if( auto childIdx = tree.childIter(); childIdx != LinkBinTree::invalid_index )
-                    tree.simplifyAlignedNode(childIdx);
-                else
-                    break;
-            }
+            //simplifyAlignedNode() may release the child, so the iterator
+            //is moved to the next sibling before the call
+            const auto children = tree.children(idx);
+            for( auto child=children.begin() ; child!=children.end() ; )
+                tree.simplifyAlignedNode(*child++);
             tree.simplifyAlignedNode(idx);
         }
-    updateContainerRect();
-    prepareGeometryChange();
-    update();
+    if( tree.isFragmented() )
+        compact();
+    updateGeometry();
+}
+
+void Link::compact()
+{
+    const auto remap = tree.compact();
+    auto remapIdx = [&remap](LinkIndex idx)
+    {
+        if( idx >= remap.size() )
+            return LinkBinTree::invalid_index;
+        return remap[idx];
+    };
+    idxStart = remapIdx(idxStart);
+    idxMid   = remapIdx(idxMid);
+    idxEnd   = remapIdx(idxEnd);
+    std::vector<LinkIndex> selection;
+    selection.reserve(selectedIdx.size());
+    for( auto idx : selectedIdx )
+        if( auto newIdx = remapIdx(idx); newIdx != LinkBinTree::invalid_index )
+            selection.push_back(newIdx);
+    selectedIdx.swap(selection);
 }
 
-bool Link::isPosOnlyEndPoint(const QPointF &pos) noexcept
+bool Link::isPosOnlyEndPoint(const QPointF &scenePos) noexcept
 {
-//    (void)pos;
-    LinkBinTree::IterPointers iter;
-    tree.resetIterator(&iter);
-    while( const auto& idx = tree.iterateIdx(&iter) )
+    const auto pos = GridPoint::fromScene(scenePos);
+    for( const auto &segment : tree.getSegmentGrid().segmentsAt(pos.toPointF()) )
     {
-        auto[idxP1,idxP2] = idx.value();
+        const auto idxP1 = segment.from;
+        const auto idxP2 = segment.to;
         if( idxP1 == idxEnd || idxP2 == idxEnd )
             continue;
         if( const auto& idx = tree.belongsToLine(idxP1,idxP2,pos) )
@@ -1395,6 +1340,18 @@ void Link::jointLink(Link &other)
 
 }
 
+void Link::commitEdit()
+{
+    if( editDepth == 0 )
+        return;
+    editDepth--;
+    if( editDepth == 0 && editPending )
+    {
+        editPending = false;
+        updateGeometry();
+    }
+}
+
 void Link::showRawData() const noexcept
 {
     tree.showNodes();
@@ -1402,7 +1359,7 @@ void Link::showRawData() const noexcept
 
 void Link::appendPort(const Block::Port *port)
 {
-    if( port->dir == Block::PortDir::Input )
+    if( port->getDir() == Block::PortDir::Input )
         pasivePorts.push_back(port->getCopy());
     else
         activePort = port->getCopy();
@@ -1417,12 +1374,12 @@ void Link::connectLinkToPortAtLastInsertedLine(Block::Port *port,
     auto idx = idxStart;
     if( !connectAtStart )
         idx = idxEnd;
-    if( tree.nodes[idx].isEmpty() )
+    if( tree.isEmpty(idx) )
         throw "port connection can not be done (connection point is empty/invalid)";
-    tree.nodes[idx].connectionPort.port = port;
-    tree.nodes[idx].connectionPort.connected = true;
+    tree.setPort(idx,port);
     port->connectionLink.link = this;
     port->connectionLink.nodeIdx = idx;
+    port->getParent()->portConnectionChanged();
     //port->connected = true;
 }
 
@@ -1431,48 +1388,53 @@ void Link::connectLinkToPort(const QPointF &pos, Block::Port *port)
     if( port == nullptr )
         throw "connectLinkToPort can not connect to a null port";
 
-    tree.resetChildIter(tree.rootIdx);
-    while( auto idx = tree.childIter() )
-        if( tree.nodes[idx].point == pos )
+    for( auto idx : tree.children(tree.rootIdx) )
+        if( tree.getPoint<UncheckedAccess>(idx) == GridPoint::fromScene(pos) )
         {
-            tree.nodes[idx].connectionPort.connected = true;
-            tree.nodes[idx].connectionPort.port = port;
+            tree.setPort(idx,port);
             //port->connected = true;
             port->connectionLink.link = this;
             port->connectionLink.nodeIdx = idx;
+            port->getParent()->portConnectionChanged();
             return;
         }
 }
 
-void Link::connectLinkToPort(uint16_t idx, Block::Port *port)
+void Link::connectLinkToPort(LinkIndex idx, Block::Port *port)
 {
     if( idx == LinkBinTree::invalid_index || port == nullptr )
         throw "connectLinkToPort can not connect to an invalid node or null port";
 
-    if( tree.nodes[idx].isEmpty() )
+    if( tree.isEmpty(idx) )
         throw "connectLinkToPort can not connect to an empty node";
 
-    tree.nodes[idx].connectionPort.connected = true;
-    tree.nodes[idx].connectionPort.port = port;
+    tree.setPort(idx,port);
     //port->connected = true;
     port->connectionLink.link = this;
     port->connectionLink.nodeIdx = idx;
+    port->getParent()->portConnectionChanged();
 }
 
-void Link::disconnectLinkFromPort(uint16_t idx)
+void Link::disconnectLinkFromPort(LinkIndex idx)
 {
     if( idx == LinkBinTree::invalid_index )
         throw "disconnectLinkFromPort invalid index";
 
-    if( tree.nodes[idx].isEmpty() )
+    if( tree.isEmpty(idx) )
         throw "disconnectLinkFromPort invalid node";
 
-    auto &port = tree.nodes[idx].connectionPort.port;
+    auto port = tree.getPort(idx);
+    if( port == nullptr )
+        throw "disconnectLinkFromPort the node is not connected";
     port->connectionLink.link = nullptr;
     port->connectionLink.nodeIdx = LinkBinTree::invalid_index;
+    port->getParent()->portConnectionChanged();
     //port->connected = false;
-    tree.nodes[idx].connectionPort.connected = false;
-    tree.nodes[idx].connectionPort.port = nullptr;
+    tree.setPort(idx,nullptr);
 }
 
+//the tree used by the links (see LinkIndex) and the other index width
+template class Link::BasicLinkBinTree<uint16_t,CheckedAccess>;
+template class Link::BasicLinkBinTree<uint32_t,CheckedAccess>;
+
 } // namespace GuiBlock
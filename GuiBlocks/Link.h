@@ -1,152 +1,361 @@
 #ifndef GUIBLOCK_LINK_H
 #define GUIBLOCK_LINK_H
 
+#include <iterator>
+#include <limits>
 #include <memory>
+#include <tuple>
 #include <vector>
 #include <QGraphicsItem>
 #include <QGraphicsSceneMouseEvent>
+#include <QLineF>
 #include <QPen>
+#include <QVector>
 #include "GuiBlocks/Block.h"
+#include "GuiBlocks/GridPoint.h"
+#include "GuiBlocks/LinkIndex.h"
+#include "GuiBlocks/SegmentGrid.h"
+#include "GuiBlocks/SegmentKernel.h"
 
 namespace GuiBlocks {
 
+//access policies of the link trees: CheckedAccess throws when a node index
+//is out of range or refers to an empty node, UncheckedAccess does not check
+struct CheckedAccess
+{
+    static constexpr bool checked = true;
+    static void check(bool inRange,bool used)
+    {
+        if( !inRange )
+            throw("index out of range");
+        if( !used )
+            throw("accesing to an invalid (empty/unused) node");
+    }
+};
+struct UncheckedAccess
+{
+    static constexpr bool checked = false;
+};
+
 class Link : public QGraphicsItem
 {
 private: //internal types
-    class LinkBinTree
+    //Index is the type of the node indexes (see LinkIndex), and Access the
+    //default policy of getPoint()/setPoint() (CheckedAccess/UncheckedAccess)
+    template<typename Index,typename Access>
+    class BasicLinkBinTree
     {
     friend Link;
     public:
         //types
-        static constexpr uint16_t invalid_index = 0xFFFF;
-        struct Node
-        {
-            Node() noexcept;
-            Node(Node && n);
-            Node(const QPointF &point,
-                 uint16_t prevNode=invalid_index,
-                 uint16_t firstChildIdx=invalid_index,
-                 uint16_t parentNextChildIdx=invalid_index) noexcept;
-            ~Node();
-            //Node& operator=(const Node &n);
-            bool isEmpty() const noexcept;
-            void makeEmpty() noexcept;
-            void resetIndexs() noexcept;
-            void setData(const QPointF &point,
-                         uint16_t prevNode=invalid_index,
-                         uint16_t firstChildIdx=invalid_index,
-                         uint16_t parentNextChildIdx=invalid_index) noexcept;
-            void show() noexcept;
-            QPointF point;
-            uint16_t firstChildIdx;
-            uint16_t parentNextChildIdx;
-            uint16_t prevNode;
-            struct
-            {
-                bool connected    = false;
-                Block::Port *port = nullptr;
-            } connectionPort;
-        };//struct Node
+        static constexpr Index invalid_index = std::numeric_limits<Index>::max();
+        //x coordinate of the empty nodes (out of the GridPoint range)
+        static constexpr int32_t empty_coordinate = INT32_MIN;
 
-        //ctors
-        LinkBinTree(const QPointF& pos) noexcept;
+        //ctors & dtor
+        //the points of the tree are in grid units (see GridPoint)
+        BasicLinkBinTree(const GridPoint& pos) noexcept;
+        //the ports still connected to the tree are disconnected
+        ~BasicLinkBinTree();
 
         //node managment
-        uint16_t appendChild(uint16_t parentIdx,const QPointF &point) noexcept;
-        uint16_t insertBefore(uint16_t targetIdx,const QPointF &point) noexcept;
-        void     removeSubTree(uint16_t targetIdx) noexcept;
-        uint16_t childrenCount(uint16_t targetIdx) noexcept;
-        uint16_t getParent(uint16_t targetIdx)const noexcept;
-        QPointF &operator[](uint16_t idx);
-        //this is a convinient method to be called instead of operator[] from a const method.
-        //since operator[] returns a QPointF& it can not be marked as const, hence can not
-        //be called from a const method
-        const QPointF &getPoint(uint16_t idx) const;
+        Index appendChild(Index parentIdx,const GridPoint &point) noexcept;
+        Index insertBefore(Index targetIdx,const GridPoint &point) noexcept;
+        void  removeSubTree(Index targetIdx) noexcept;
+        //both are kept in the nodes, so they do not walk the sibling chains
+        Index childrenCount(Index targetIdx) const noexcept{ return childCount[targetIdx]; }
+        Index getParent(Index targetIdx) const noexcept{ return parent[targetIdx]; }
+        //an empty node is a node that is not being used (released)
+        bool  isEmpty(Index idx) const noexcept{ return x[idx] == empty_coordinate; }
+        //the coordinates are stored in separated arrays, so the points are
+        //returned by value and modified through setPoint().
+        //The hot paths can skip the checks with getPoint<UncheckedAccess>()
+        template<typename Policy=Access>
+        GridPoint getPoint(Index idx) const noexcept(!Policy::checked)
+        {
+            if constexpr( Policy::checked )
+                Policy::check(idx < x.size(),idx < x.size() && !isEmpty(idx));
+            return GridPoint(x[idx],y[idx]);
+        }
+        template<typename Policy=Access>
+        void setPoint(Index idx,const GridPoint &point) noexcept(!Policy::checked)
+        {
+            if constexpr( Policy::checked )
+                Policy::check(idx < x.size(),idx < x.size() && !isEmpty(idx));
+            moveBounds(idx,point);
+            x[idx] = point.x;
+            y[idx] = point.y;
+            growBounds(idx);
+            invalidateSegments();
+        }
+        //port bound to the node (nullptr if there is none). Binding a nullptr
+        //removes the binding. The connectionLink of the port is not modified
+        Block::Port* getPort(Index idx) const noexcept;
+        void         setPort(Index idx,Block::Port *port) noexcept;
 
         //general methods
-        const QRectF& getContainerRect() const noexcept{ return containerRect; }
-        uint16_t length() const noexcept;
+        //top left and bottom right points of the smallest rect that contains
+        //the used nodes (in grid units). See bounds
+        std::tuple<GridPoint,GridPoint> getBounds() const noexcept;
+        Index length() const noexcept{ return liveCount; }
+        //number of nodes in the storage (used and empty ones)
+        Index storageSize() const noexcept{ return Index(x.size()); }
+        //true when there are more unused (empty) nodes than used ones
+        bool isFragmented() const noexcept{ return x.size()-liveCount > liveCount; }
+        //moves all the used nodes to the front of the storage (keeping their
+        //relative order) and releases the empty ones. Returns the old->new index
+        //map (invalid_index for the nodes that were empty) so the owner can
+        //update the indexes it keeps. The ports connected to the tree are
+        //updated by this method.
+        std::vector<Index> compact();
+        //the segment grid and kernel are rebuilt on demand after this call
+        void invalidateSegments() const noexcept;
+        //if the root has two children aligned with it, the root is removed
+        //and the second child is appended to the first one (the new root)
+        bool simplifyRootNode() noexcept;
 
         //iterators
-        //this methods will iterate through all the nodes
-        //(including startIdx) that are connected
-        void resetSubTreeIterator(uint16_t startIdx) noexcept;
-        uint16_t iterateSubTree() noexcept;
-        //for public use:
-        //The user can use multiple instances of IterPointers and
-        //pass them to the resetIterator() and iterate()/iterateIdx()
-        //as argument to iterate in parallel without conflicts
-        class IterPointers
+        //The iterators only keep the indexes they are at, so any number of
+        //them can walk the same tree at once (also from several threads, if
+        //the tree is not modified). Modifying the tree invalidates them.
+        //The nodes are walked in pre-order (parent first, then the children
+        //in sibling order)
+        //nodes of the subtree that hangs from startIdx (startIdx included)
+        class NodeIterator
         {
-        friend LinkBinTree;
+        friend BasicLinkBinTree;
         public:
-            IterPointers(uint16_t startIdx=invalid_index):iterStart(startIdx){}
+            using iterator_category = std::forward_iterator_tag;
+            using value_type        = Index;
+            using difference_type   = std::ptrdiff_t;
+            using pointer           = const Index*;
+            using reference         = Index;
+
+            NodeIterator() noexcept {}
+            Index operator*() const noexcept{ return idx; }
+            NodeIterator& operator++() noexcept{ idx = tree->nextPreOrder(start,idx); return *this; }
+            NodeIterator operator++(int) noexcept{ auto it = *this; ++*this; return it; }
+            bool operator==(const NodeIterator &other) const noexcept{ return idx == other.idx; }
+            bool operator!=(const NodeIterator &other) const noexcept{ return idx != other.idx; }
         private:
-            uint16_t iterStart;
-            uint16_t iterParent;
-            uint16_t iterChild;
+            NodeIterator(const BasicLinkBinTree *tree,Index start,Index idx) noexcept
+                : tree(tree),start(start),idx(idx){}
+            const BasicLinkBinTree *tree = nullptr;
+            Index start = invalid_index;
+            Index idx   = invalid_index;
         };
-        void resetIterator(IterPointers *pointers=nullptr) const noexcept;
-        std::optional<std::tuple<const QPointF&,const QPointF&>>
-        iterate(IterPointers *pointers=nullptr) const noexcept;
-        //this behaves as iterate() but retorning the indexs of the points
-        std::optional<std::tuple<uint16_t,uint16_t>>
-        iterateIdx(IterPointers *pointers=nullptr) const noexcept;
+        //segments (parent,child) of the subtree that hangs from startIdx.
+        //Each node but startIdx is the child of one segment, so this walks
+        //the nodes and pairs them with their parents
+        class SegmentIterator
+        {
+        friend BasicLinkBinTree;
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type        = std::tuple<Index,Index>;
+            using difference_type   = std::ptrdiff_t;
+            using pointer           = const value_type*;
+            using reference         = value_type;
+
+            SegmentIterator() noexcept {}
+            value_type operator*() const noexcept{ return {node.tree->parent[*node],*node}; }
+            SegmentIterator& operator++() noexcept{ ++node; return *this; }
+            SegmentIterator operator++(int) noexcept{ auto it = *this; ++*this; return it; }
+            bool operator==(const SegmentIterator &other) const noexcept{ return node == other.node; }
+            bool operator!=(const SegmentIterator &other) const noexcept{ return node != other.node; }
+        private:
+            SegmentIterator(const NodeIterator &node) noexcept : node(node){}
+            NodeIterator node;
+        };
+        //children of parentIdx (in sibling order)
+        class ChildIterator
+        {
+        friend BasicLinkBinTree;
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type        = Index;
+            using difference_type   = std::ptrdiff_t;
+            using pointer           = const Index*;
+            using reference         = Index;
+
+            ChildIterator() noexcept {}
+            Index operator*() const noexcept{ return idx; }
+            ChildIterator& operator++() noexcept{ idx = tree->nextSibling[idx]; return *this; }
+            ChildIterator operator++(int) noexcept{ auto it = *this; ++*this; return it; }
+            bool operator==(const ChildIterator &other) const noexcept{ return idx == other.idx; }
+            bool operator!=(const ChildIterator &other) const noexcept{ return idx != other.idx; }
+        private:
+            ChildIterator(const BasicLinkBinTree *tree,Index idx) noexcept : tree(tree),idx(idx){}
+            const BasicLinkBinTree *tree = nullptr;
+            Index idx = invalid_index;
+        };
+        template<typename Iterator>
+        class Range
+        {
+        public:
+            Range(const Iterator &first,const Iterator &last) noexcept : first(first),last(last){}
+            Iterator begin() const noexcept{ return first; }
+            Iterator end()   const noexcept{ return last; }
+            bool empty() const noexcept{ return first == last; }
+        private:
+            Iterator first,last;
+        };
+        //an invalid or empty start/parent node gives an empty range, and
+        //segments() walks the whole tree when startIdx is invalid_index
+        Range<SegmentIterator> segments(Index startIdx=invalid_index) const noexcept
+        {
+            if( startIdx == invalid_index )
+                startIdx = rootIdx;
+            //the first segment ends at the node that follows startIdx
+            auto nodes = subtree(startIdx);
+            auto first = nodes.begin();
+            if( first != nodes.end() )
+                ++first;
+            return {SegmentIterator(first),SegmentIterator(nodes.end())};
+        }
+        Range<NodeIterator> subtree(Index startIdx) const noexcept
+        {
+            const NodeIterator last(this,startIdx,invalid_index);
+            if( !isUsed(startIdx) )
+                return {last,last};
+            return {NodeIterator(this,startIdx,startIdx),last};
+        }
+        Range<ChildIterator> children(Index parentIdx) const noexcept
+        {
+            const ChildIterator last(this,invalid_index);
+            if( !isUsed(parentIdx) )
+                return {last,last};
+            return {ChildIterator(this,firstChild[parentIdx]),last};
+        }
 
         //debug
         void showNodes() const noexcept;
-        void showIteration(uint16_t startIdx=invalid_index) noexcept;
-        void showSubTreeIterations(uint16_t startIdx) noexcept;
+        //checks the links of the nodes against each other (prev, parent,
+        //childCount, the free list and liveCount). The first broken invariant
+        //found is reported with qDebug and false is returned
+        bool checkInvariants() const noexcept;
+        void showIteration(Index startIdx=invalid_index) const noexcept;
+        void showSubTreeIterations(Index startIdx) const noexcept;
 
     private://internal methods
-        //iterator for internal use:
-        //call first resetChildIter with a valid parentIdx, and then call
-        //childIter to iterate over the parentIdx's childrens
-        void resetChildIter(uint16_t parentIdx) noexcept;
-        uint16_t childIter() noexcept;
-
-        //return the first unused (empty) node after startIdx,
-        //or invalid_index if none available
-        uint16_t nextEmptyNode(uint16_t startIdx=0) const noexcept;
-        //pick the first unused (empty) node, or creates a new one
-        uint16_t createNode(const QPointF &pos,
-                            uint16_t prevNode=invalid_index,
-                            uint16_t firstChildIdx=invalid_index,
-                            uint16_t parentNextChildIdx=invalid_index) noexcept;
+        //node that follows idx in the pre-order walk of the subtree that
+        //hangs from startIdx (invalid_index after the last one)
+        Index nextPreOrder(Index startIdx,Index idx) const noexcept
+        {
+            if( firstChild[idx] != invalid_index )
+                return firstChild[idx];
+            //goes up until a node with a next sibling is found
+            while( idx != startIdx )
+            {
+                if( nextSibling[idx] != invalid_index )
+                    return nextSibling[idx];
+                idx = parent[idx];
+            }
+            return invalid_index;
+        }
+        //true if idx is a used node of the storage
+        bool isUsed(Index idx) const noexcept{ return idx < x.size() && !isEmpty(idx); }
+
+        //pops an unused (empty) node from the free list, or creates a new one
+        //The new node has one child at most (firstChildIdx)
+        Index createNode(const GridPoint &pos,
+                            Index parentIdx=invalid_index,
+                            Index prevIdx=invalid_index,
+                            Index firstChildIdx=invalid_index,
+                            Index nextSiblingIdx=invalid_index) noexcept;
+        void setNode(Index idx,
+                     const GridPoint &pos,
+                     Index parentIdx,
+                     Index prevIdx,
+                     Index firstChildIdx,
+                     Index nextSiblingIdx) noexcept;
+        //marks the node as empty and pushes it on the free list. The links of
+        //the node are overwritten, so the caller must read them before.
+        //A port bound to the node is disconnected
+        void releaseNode(Index idx) noexcept;
 
         //this method removes targetIdx if it is located on the line
-        //between prevNode and firstChildIdx of it, and if targetIdx
+        //between prev and firstChild of it, and if targetIdx
         //has only one child (ie, its a jointnode, see isJointNode method)
-        bool simplifyAlignedNode(uint16_t targetIdx) noexcept;
+        bool simplifyAlignedNode(Index targetIdx) noexcept;
 
         //helpers:
-        //the next two methods are only to be used from iterator() method
-        //(since does not check boundaries)
-        bool isParent(uint16_t parentIdx,uint16_t childIdx) const noexcept;
-        bool prevNodeIsParent(uint16_t childIdx) const noexcept;
+        //does not check boundaries
+        bool isParent(Index parentIdx,Index childIdx) const noexcept;
         //if a node has more tha one child, it is considered as a jointnode
-        bool isJointNode(uint16_t targetIdx) const noexcept;
+        bool isJointNode(Index targetIdx) const noexcept;
         //if point is on the line joining two nodes, this method returns the
         //indexs of the two nodes. If point is exactly one node, will return
         //the node index as first output arg and invalid_index as the second
-        std::optional<std::tuple<uint16_t,uint16_t>> isOnTrajectory(const QPointF &point) const noexcept;
-        std::optional<std::tuple<uint16_t,uint16_t>> isOnTrajectory(const QRectF &rect) const noexcept;
-        std::optional<std::tuple<uint16_t,uint16_t>> isMiddleOfLine(uint16_t targetIdx) const noexcept;
-        bool isBetweenTwoNodes(uint16_t targetIdx) const noexcept;
-        std::optional<std::tuple<uint16_t,uint16_t>> belongsToLine(uint16_t idxP1,
-                                                                   uint16_t idxP2,
-                                                                   const QPointF& point) const noexcept;
+        //(the candidate segments are taken from the segment kernel, or from
+        //the segment grid for the long links)
+        std::optional<std::tuple<Index,Index>> isOnTrajectory(const GridPoint &point) const noexcept;
+        //the same for the segments crossing the rect from topLeft to
+        //bottomRight (closed, in grid units)
+        std::optional<std::tuple<Index,Index>> isOnTrajectory(const GridPoint &topLeft,
+                                                              const GridPoint &bottomRight) const noexcept;
+        std::optional<std::tuple<Index,Index>> isMiddleOfLine(Index targetIdx) const noexcept;
+        bool isBetweenTwoNodes(Index targetIdx) const noexcept;
+        std::optional<std::tuple<Index,Index>> belongsToLine(Index idxP1,
+                                                                   Index idxP2,
+                                                                   const GridPoint& point) const noexcept;
+        //bounds maintenance: growBounds() extends them to contain the node,
+        //moveBounds() must be called before the node moves to point (and
+        //growBounds() after it) and releaseBounds() before the node is released
+        void growBounds(Index idx) const noexcept;
+        void moveBounds(Index idx,const GridPoint &point) noexcept;
+        void releaseBounds(Index idx) noexcept;
+        void updateBounds() const noexcept;
+        //returns the segment grid/kernel, rebuilding them if they were invalidated
+        const SegmentGrid& getSegmentGrid() const;
+        const SegmentKernel& getSegmentKernel() const;
+        void updateSegments() const;
 
         //vars
-        std::vector<Node> nodes;
-        QRectF containerRect;
-        uint16_t rootIdx;
-        //iterator vars
-        mutable IterPointers iterPointers;
-        uint16_t iterSubTreeStart;
-        uint16_t iterSubTreeIdx;
-        uint16_t iterChildIdx;
-    };  //class LinkBinTree  //class LinkBinTree
+        //nodes storage (structure of arrays, all indexed by node index).
+        //An empty node has x = empty_coordinate
+        std::vector<int32_t>  x;
+        std::vector<int32_t>  y;
+        std::vector<Index> prev;         //parent or previous sibling
+        std::vector<Index> firstChild;
+        std::vector<Index> nextSibling;
+        std::vector<Index> parent;       //invalid_index for the root
+        std::vector<Index> childCount;
+        //only a few nodes are connected to ports, so the bindings are
+        //kept aside of the nodes
+        struct PortBinding
+        {
+            Index nodeIdx;
+            Block::Port *port;
+        };
+        std::vector<PortBinding> ports;
+        //bounds of the used nodes (left, top, right and bottom sides) and the
+        //node that holds each side. They grow as the nodes move outwards, and
+        //are recomputed (on demand) only when a node that holds a side moves
+        //inwards or is released
+        enum BoundSide{ left,top,right,bottom };
+        struct Bounds
+        {
+            int32_t side[4];
+            Index   holder[4];
+            bool    valid = false;
+        };
+        mutable Bounds bounds;
+        Index rootIdx;
+        //node pool: the empty nodes are chained through their firstChild
+        Index freeHead  = invalid_index;
+        Index liveCount = 0;
+        //the links with more segments than this use the segment grid to
+        //select the candidates of the point hit tests
+        static constexpr size_t gridMinSegments = 64;
+        //packed segments and bucket index of the segments, used to speed up
+        //the hit tests
+        mutable SegmentKernel segmentKernel;
+        mutable SegmentGrid segmentGrid;
+        //segments found by isOnTrajectory(rect), kept to reuse the storage
+        mutable std::vector<SegmentGrid::Segment> rectCandidates;
+    };  //class BasicLinkBinTree
+    using LinkBinTree = BasicLinkBinTree<LinkIndex,CheckedAccess>;
 public: //exported types
     enum class LinkPath
     {
@@ -160,14 +369,19 @@ public: //exported types
 public: //ctors & dtor
     Link(const QPointF &startPos);
 //    Link(const Link& l);
+    ~Link() override;
 
 public: //pure virtual methods
+    enum { Type = TypeID::LinkID };     //for qgraphicsitem_cast()
+    int type() const override { return Type; }
     QRectF boundingRect() const override { return containerRect; }
     void paint(QPainter *painter,
                const QStyleOptionGraphicsItem *option,
                QWidget *widget = nullptr) override;
 
 public: //general methods
+    //the lines of the link as drawn (in scene coordinates)
+    const QVector<QLineF>& getLines();
     bool isPartOfLink(const QPointF &point) const noexcept;
     bool isPartOfLink(const QRectF &rect) const noexcept;
     void insertLineAt(const QPointF &start,const QPointF &end,const LinkPath &linkPath) noexcept;
@@ -181,12 +395,21 @@ public: //general methods
     bool isSelectedAreaMovable() const noexcept;
     bool isConnectedAtPoint(const QPointF& point) const noexcept;
     void displaceSelectedArea(const QPointF &offset) noexcept;
-    void moveSelectedNode(uint16_t nodeIdx,const QPointF &to);
+    void moveSelectedNode(LinkIndex nodeIdx,const QPointF &to);
     void simplifySelectedArea() noexcept;
+    //defragments the node storage of the tree and remaps the indexes held by
+    //the link (line indexes, selection and the connected ports)
+    void compact();
     bool isPosOnlyEndPoint(const QPointF &pos) noexcept;
     auto length()const noexcept{ return tree.length(); }
     bool isEmpty() const noexcept{ return tree.length()<=1; }
     void jointLink(Link& other);
+    //edit batching: between beginEdit() and its commitEdit() the bounds,
+    //the scene index and the repaint of the link are not updated, the
+    //outermost commitEdit() updates them once. The calls can be nested
+    //(see LinkEditScope)
+    void beginEdit() noexcept{ editDepth++; }
+    void commitEdit();
 
     void showRawData() const noexcept;
 
@@ -196,29 +419,38 @@ public: //general methods
     void connectLinkToPortAtLastInsertedLine(Block::Port *port,
                                              bool connectAtStart);
     void connectLinkToPort(const QPointF &pos,Block::Port *port);
-    void connectLinkToPort(uint16_t idx,Block::Port *port);
-    void disconnectLinkFromPort(uint16_t idx);
+    void connectLinkToPort(LinkIndex idx,Block::Port *port);
+    void disconnectLinkFromPort(LinkIndex idx);
 
+protected:
+    //reports the changes to the Scene (see Scene::itemChange())
+    QVariant itemChange(GraphicsItemChange change,const QVariant &value) override;
 
 private: //internal methods
-    std::optional<QPointF> computeMidPoint(const QPointF  &startPoint,
-                                           const QPointF  &endPoint,
-                                           const LinkPath &linkPath) const noexcept;
-    void updateContainerRect();
-    bool simplifyRootNode() noexcept;
+    std::optional<GridPoint> computeMidPoint(const GridPoint &startPoint,
+                                             const GridPoint &endPoint,
+                                             const LinkPath  &linkPath) const noexcept;
+    //bounds of the nodes (in scene coordinates) plus a margin
+    QRectF computeContainerRect() const noexcept;
+    //to be called after any modification of the tree: invalidates the
+    //cached data, updates the bounding rect and schedules a repaint
+    void updateGeometry();
     //this method will return the indexs of the two points of the line grabbed or
     //the index of the point grabbed (in the first element of the tuple, the second will be invalid_index)
-    std::tuple<uint16_t,uint16_t> getGrabbedIndexs(const QPointF &pos) const noexcept;
+    std::tuple<LinkIndex,LinkIndex> getGrabbedIndexs(const GridPoint &pos) const noexcept;
+    //rebuilds the lines and junctions drawn by paint()
+    void updateRenderCache();
+    void paintDebugInfo(QPainter *painter) const;
 
 private: //internal vars
     //indexs of the lines
-    uint16_t idxStart = 0;
-    uint16_t idxMid   = LinkBinTree::invalid_index;
-    uint16_t idxEnd   = LinkBinTree::invalid_index;
+    LinkIndex idxStart = 0;
+    LinkIndex idxMid   = LinkBinTree::invalid_index;
+    LinkIndex idxEnd   = LinkBinTree::invalid_index;
     //stores the points of the link
     LinkBinTree tree;
     //indexes that will be loaded by selectArea() and then moved by moveSelection()
-    std::vector<uint16_t> selectedIdx;
+    std::vector<LinkIndex> selectedIdx;
     //to store the multiples pasive ports
     std::vector<std::weak_ptr<Block::Port>> pasivePorts;
     //to store the only active port that can be connected to a link
@@ -226,16 +458,45 @@ private: //internal vars
 
     QRectF containerRect;
 
-private: //internals for debug porpouses
+    //what paint() draws (in scene coordinates), so the tree is only walked
+    //when the geometry changes. updateGeometry() invalidates it
     struct
     {
-        QPen pen = QPen(QBrush(StyleLink::normalColor),
-                        qreal(StyleLink::width),
-                        Qt::SolidLine,
-                        Qt::RoundCap);
-    }debug;
+        QVector<QLineF>  lines;
+        QVector<QPointF> junctions;   //nodes with more than one child
+        QPen linePen;
+        QPen junctionPen;
+        QPen flatPen;       //see StyleLevelOfDetail
+        bool valid = false;
+    }render;
+
+    //see beginEdit()
+    int  editDepth   = 0;
+    bool editPending = false;
 
 };
+
+//batches the edits of a link while the scope is alive (see Link::beginEdit())
+class LinkEditScope
+{
+public:
+    explicit LinkEditScope(Link *link) noexcept : link(link)
+    {
+        if( link != nullptr )
+            link->beginEdit();
+    }
+    LinkEditScope(LinkEditScope &&other) noexcept : link(other.link){ other.link = nullptr; }
+    LinkEditScope(const LinkEditScope&) = delete;
+    LinkEditScope& operator=(const LinkEditScope&) = delete;
+    LinkEditScope& operator=(LinkEditScope&&) = delete;
+    ~LinkEditScope()
+    {
+        if( link != nullptr )
+            link->commitEdit();
+    }
+private:
+    Link *link;
+};
 } // namespace GuiBlock
 
 #endif // GUIBLOCK_LINK_H
@@ -0,0 +1,19 @@
+#ifndef GUIBLOCKS_LINKINDEX_H
+#define GUIBLOCKS_LINKINDEX_H
+
+#include <cstdint>
+
+namespace GuiBlocks {
+
+//Type of the node indexes of the links. The 16 bits index keeps the nodes
+//compact but limits a link to 65534 nodes, define GUIBLOCKS_LINK_WIDE_INDEX
+//to use 32 bits indexes (huge nets)
+#ifdef GUIBLOCKS_LINK_WIDE_INDEX
+using LinkIndex = uint32_t;
+#else
+using LinkIndex = uint16_t;
+#endif
+
+} // namespace GuiBlocks
+
+#endif // GUIBLOCKS_LINKINDEX_H
@@ -0,0 +1,88 @@
+#include "Panner.h"
+
+#include "Style.h"
+#include <QScrollBar>
+#include <algorithm>
+#include <cmath>
+
+namespace GuiBlocks {
+
+Panner::Panner(QGraphicsView *view)
+    : view(view)
+{
+    timer.setInterval(StylePan::frameInterval);
+    QObject::connect(&timer,&QTimer::timeout,[this]{ step(); });
+}
+
+void Panner::press(const QPoint &pos)
+{
+    stop();
+    panning = true;
+    last = pos;
+    clock.start();
+}
+
+void Panner::move(const QPoint &pos)
+{
+    if( !panning )
+        return;
+    //the contents follow the mouse
+    const QPoint delta = last-pos;
+    last = pos;
+    scrollBy(delta);
+    //the events are not evenly spaced, so the speed is smoothed
+    const double dt = double(std::max<qint64>(1,clock.restart()));
+    velocity = 0.8*(QPointF(delta)/dt) + 0.2*velocity;
+}
+
+void Panner::release()
+{
+    if( !panning )
+        return;
+    panning = false;
+    //the mouse stopped before the release
+    if( !StylePan::kinetic || clock.elapsed() > StylePan::flingTimeout ||
+        std::hypot(velocity.x(),velocity.y()) < StylePan::minSpeed )
+    {
+        velocity = QPointF();
+        return;
+    }
+    remainder = QPointF();
+    clock.start();
+    timer.start();
+}
+
+void Panner::stop()
+{
+    timer.stop();
+    velocity = QPointF();
+}
+
+bool Panner::scrollBy(const QPoint &delta)
+{
+    auto horizontal = view->horizontalScrollBar();
+    auto vertical   = view->verticalScrollBar();
+    const QPoint before(horizontal->value(),vertical->value());
+    horizontal->setValue(horizontal->value()+delta.x());
+    vertical->setValue(vertical->value()+delta.y());
+    return delta.isNull() || QPoint(horizontal->value(),vertical->value()) != before;
+}
+
+void Panner::step()
+{
+    //the timer can fire late, so the friction is applied per elapsed frame
+    const double dt = double(clock.restart());
+    velocity *= std::pow(StylePan::friction,dt/StylePan::frameInterval);
+    if( std::hypot(velocity.x(),velocity.y()) < StylePan::minSpeed )
+    {
+        stop();
+        return;
+    }
+    remainder += velocity*dt;
+    const QPoint delta(int(remainder.x()),int(remainder.y()));
+    remainder -= QPointF(delta);
+    if( !scrollBy(delta) )
+        stop();
+}
+
+} // namespace GuiBlocks
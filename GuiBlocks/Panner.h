@@ -0,0 +1,50 @@
+#ifndef GUIBLOCKS_PANNER_H
+#define GUIBLOCKS_PANNER_H
+
+#include <QElapsedTimer>
+#include <QGraphicsView>
+#include <QPoint>
+#include <QPointF>
+#include <QTimer>
+
+namespace GuiBlocks {
+
+//Pans a QGraphicsView with its scroll bars, so the view scrolls the pixels
+//already drawn in the viewport (and its cached background) and only draws
+//the strips that come into view. The View scrolls over a scene rect of
+//StylePan::sceneExtent, with the scroll bars hidden.
+//With StylePan::kinetic the view keeps scrolling after the release at the
+//speed of the drag, slowing down from a timer, until the next press
+class Panner
+{
+public:
+    explicit Panner(QGraphicsView *view);
+
+    //the positions are in viewport coordinates
+    void press(const QPoint &pos);
+    void move(const QPoint &pos);
+    void release();
+    //stops the kinetic scrolling
+    void stop();
+    //dragging or scrolling after the release
+    bool isActive() const { return panning || timer.isActive(); }
+    bool isPanning() const noexcept { return panning; }
+
+private:
+    //scrolls the contents of the view by delta pixels, false at the
+    //limits of the scene rect
+    bool scrollBy(const QPoint &delta);
+    void step();
+
+    QGraphicsView *view;
+    bool panning = false;
+    QPoint last;
+    QPointF velocity;       //pixels per ms, in the scroll direction
+    QPointF remainder;      //the fraction of pixel not scrolled yet
+    QElapsedTimer clock;    //since the last move or step
+    QTimer timer;
+};
+
+} // namespace GuiBlocks
+
+#endif // GUIBLOCKS_PANNER_H
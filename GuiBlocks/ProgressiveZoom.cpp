@@ -0,0 +1,121 @@
+#include "ProgressiveZoom.h"
+
+#include "Style.h"
+#include <QPainter>
+#include <algorithm>
+
+namespace GuiBlocks {
+
+ProgressiveZoom::ProgressiveZoom(QGraphicsView *view)
+    : view(view)
+{
+    idleTimer.setSingleShot(true);
+    idleTimer.setInterval(StyleZoom::idleTimeout);
+    QObject::connect(&idleTimer,&QTimer::timeout,[this]{ apply(); });
+    stripTimer.setInterval(StyleZoom::stripInterval);
+    QObject::connect(&stripTimer,&QTimer::timeout,[this]{ nextStrip(); });
+}
+
+void ProgressiveZoom::zoom(double factor,const QPointF &pos)
+{
+    if( state != State::Previewing )
+    {
+        //the frame on screen (the strips of a previous zoom are finished
+        //first, grab() draws the view)
+        finish();
+        snapshot = view->viewport()->grab();
+        preview = QTransform();
+        state = State::Previewing;
+    }
+    preview *= QTransform::fromTranslate(-pos.x(),-pos.y())*
+               QTransform::fromScale(factor,factor)*
+               QTransform::fromTranslate(pos.x(),pos.y());
+    //restarted by each step of the burst
+    idleTimer.start();
+    view->viewport()->update();
+}
+
+double ProgressiveZoom::targetZoom() const
+{
+    //the view is not rotated, so m11 is its zoom
+    const double zoom = view->transform().m11();
+    return state == State::Previewing ? zoom*preview.m11() : zoom;
+}
+
+void ProgressiveZoom::finish()
+{
+    if( state == State::Previewing )
+        apply();
+    if( state != State::Rendering )
+        return;
+    for( int idx=stripsRendered ; idx<strips() ; idx++ )
+        view->viewport()->update(strip(idx));
+    stripTimer.stop();
+    state = State::Idle;
+    snapshot = QPixmap();
+}
+
+QRegion ProgressiveZoom::drawPreview(const QRegion &region)
+{
+    QRegion rendered;
+    if( state == State::Rendering )
+        for( int idx=0 ; idx<stripsRendered ; idx++ )
+            rendered += strip(idx);
+    const QRegion previewed = region.subtracted(rendered);
+    if( !previewed.isEmpty() )
+    {
+        //the snapshot does not cover the viewport when zooming out
+        QPainter painter(view->viewport());
+        painter.setClipRegion(previewed);
+        painter.fillRect(view->viewport()->rect(),view->backgroundBrush());
+        painter.setTransform(preview);
+        painter.drawPixmap(QPointF(),snapshot);
+    }
+    return region.intersected(rendered);
+}
+
+void ProgressiveZoom::apply()
+{
+    idleTimer.stop();
+    //the view is scaled around its center, which then shows the scene
+    //point that the preview put there
+    const QPointF center = QRectF(view->viewport()->rect()).center();
+    const QPointF sceneCenter = view->viewportTransform().inverted().map(preview.inverted().map(center));
+    const auto anchor = view->transformationAnchor();
+    view->setTransformationAnchor(QGraphicsView::NoAnchor);
+    view->scale(preview.m11(),preview.m22());
+    view->centerOn(sceneCenter);
+    view->setTransformationAnchor(anchor);
+
+    //the snapshot is now where the preview showed it, so it is kept over
+    //the strips not drawn yet
+    state = State::Rendering;
+    stripsRendered = 1;
+    view->viewport()->update();
+    stripTimer.start();
+}
+
+void ProgressiveZoom::nextStrip()
+{
+    if( stripsRendered >= strips() )
+    {
+        finish();
+        return;
+    }
+    view->viewport()->update(strip(stripsRendered));
+    stripsRendered++;
+}
+
+int ProgressiveZoom::strips()
+{
+    return std::max(1,StyleZoom::renderStrips);
+}
+
+QRect ProgressiveZoom::strip(int idx) const
+{
+    const QRect viewport = view->viewport()->rect();
+    const int height = (viewport.height()+strips()-1)/strips();
+    return QRect(0,idx*height,viewport.width(),height) & viewport;
+}
+
+} // namespace GuiBlocks
@@ -0,0 +1,66 @@
+#ifndef GUIBLOCKS_PROGRESSIVEZOOM_H
+#define GUIBLOCKS_PROGRESSIVEZOOM_H
+
+#include <QGraphicsView>
+#include <QPixmap>
+#include <QPointF>
+#include <QRect>
+#include <QRegion>
+#include <QTimer>
+#include <QTransform>
+
+namespace GuiBlocks {
+
+//Zooms a QGraphicsView in two steps, so a burst of wheel events does not
+//draw the scene at every step:
+// - while the wheel turns, the view shows its last frame (grabbed once
+//   per burst) scaled around the mouse positions of the steps.
+// - once the wheel is idle for StyleZoom::idleTimeout, the view is scaled
+//   to show what the preview showed, and the new frame is drawn in
+//   StyleZoom::renderStrips strips, one per timer tick, with the preview
+//   over the strips not drawn yet.
+//The events that map positions to the scene need the real transform, so
+//they call finish() first
+class ProgressiveZoom
+{
+public:
+    explicit ProgressiveZoom(QGraphicsView *view);
+
+    //scales the preview by factor around pos (viewport coordinates)
+    void zoom(double factor,const QPointF &pos);
+    //the zoom of the view once the preview is applied
+    double targetZoom() const;
+    //applies the preview and draws the whole frame now
+    void finish();
+    bool isActive() const noexcept { return state != State::Idle; }
+
+    //draws the preview over the part of region (viewport coordinates)
+    //whose strips are not drawn yet, and returns the part to draw
+    QRegion drawPreview(const QRegion &region);
+
+private:
+    enum class State
+    {
+        Idle,
+        Previewing, //the wheel turns
+        Rendering   //the view is scaled, the strips are being drawn
+    };
+
+    //scales the view as the preview and starts drawing the strips
+    void apply();
+    void nextStrip();
+    static int strips();
+    QRect strip(int idx) const;
+
+    QGraphicsView *view;
+    State state = State::Idle;
+    QPixmap snapshot;
+    QTransform preview;     //viewport coordinates, from the snapshot to the zoomed view
+    int stripsRendered = 0; //the strips that can be drawn
+    QTimer idleTimer;
+    QTimer stripTimer;
+};
+
+} // namespace GuiBlocks
+
+#endif // GUIBLOCKS_PROGRESSIVEZOOM_H
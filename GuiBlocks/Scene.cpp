@@ -5,7 +5,73 @@ namespace GuiBlocks {
 Scene::Scene(QObject *parent)
     : QGraphicsScene(parent)
 {
-    //setItemIndexMethod(QGraphicsScene::NoIndex);
+    //the BSP index keeps the exposed-rect queries of the views logarithmic
+    //(the views hit test through the HitTester). It relies on the items
+    //calling prepareGeometryChange() before changing their bounding rect
+    //(see Link::updateGeometry()).
+    //The tree depth is left to Qt, which adapts it to the number of items
+    setItemIndexMethod(QGraphicsScene::BspTreeIndex);
+}
+
+Scene* Scene::of(const QGraphicsItem *item)
+{
+    //the scene is not a Scene while it is being destroyed
+    return dynamic_cast<Scene*>(item->scene());
+}
+
+void Scene::itemChange(QGraphicsItem *item,QGraphicsItem::GraphicsItemChange change)
+{
+    //scene() is the old scene on ItemSceneChange and the new one on ItemSceneHasChanged
+    auto scene = of(item);
+    if( !scene )
+        return;
+    switch( change )
+    {
+        case QGraphicsItem::ItemSceneChange:
+            scene->hitTester.remove(item);
+            scene->zOrder.remove(item);
+            scene->densityMap.remove(item);
+            break;
+        case QGraphicsItem::ItemSceneHasChanged:
+            scene->hitTester.insert(item);
+            scene->zOrder.insert(item);
+            scene->densityMap.insert(item);
+            break;
+        case QGraphicsItem::ItemPositionHasChanged:
+            scene->hitTester.update(item);
+            scene->densityMap.update(item);
+            break;
+        case QGraphicsItem::ItemZValueHasChanged:
+            scene->hitTester.update(item);
+            break;
+        default:
+            break;
+    }
+}
+
+void Scene::itemGeometryChanged(QGraphicsItem *item)
+{
+    if( auto scene = of(item) )
+    {
+        scene->hitTester.update(item);
+        scene->densityMap.update(item);
+    }
+}
+
+void Scene::itemDeleted(const QGraphicsItem *item)
+{
+    if( auto scene = of(item) )
+    {
+        scene->hitTester.remove(item);
+        scene->zOrder.remove(item);
+        scene->densityMap.remove(item);
+    }
+}
+
+void Scene::itemAppearanceChanged(QGraphicsItem *item)
+{
+    if( auto scene = of(item) )
+        emit scene->appearanceChanged(item);
 }
 
 } // namespace GuiBlocks
@@ -2,6 +2,10 @@
 #define SCENE_H
 
 #include <QGraphicsScene>
+#include "GuiBlocks/BlockAtlas.h"
+#include "GuiBlocks/DensityMap.h"
+#include "GuiBlocks/HitTester.h"
+#include "GuiBlocks/ZOrderManager.h"
 
 namespace GuiBlocks {
 
@@ -12,6 +16,35 @@ public:
     Scene(QObject *parent = nullptr);
     virtual ~Scene() override {}
 
+    //the Scene of item, or nullptr
+    static Scene* of(const QGraphicsItem *item);
+    //the blocks and links report their changes to the scene they are in:
+    //from itemChange(), after changing their bounding rect and from their
+    //destructors (the scene does not notify the items deleted while in it)
+    static void itemChange(QGraphicsItem *item,QGraphicsItem::GraphicsItemChange change);
+    static void itemGeometryChanged(QGraphicsItem *item);
+    static void itemDeleted(const QGraphicsItem *item);
+    //the look of item changed without changing its geometry (as the
+    //connectors of a block when its ports are connected)
+    static void itemAppearanceChanged(QGraphicsItem *item);
+
+    //the blocks and links of the scene, for the hit tests of the views
+    HitTester& getHitTester() { return hitTester; }
+    ZOrderManager& getZOrder() { return zOrder; }
+    //for the overview of the views
+    DensityMap& getDensityMap() { return densityMap; }
+    //bodies of the blocks, shared by the views (see Block::paint())
+    BlockAtlas& getBlockAtlas() { return blockAtlas; }
+
+signals:
+    //for the views that keep the drawing of the items (see LayerCompositor)
+    void appearanceChanged(QGraphicsItem *item);
+
+private:
+    HitTester     hitTester;
+    ZOrderManager zOrder;
+    DensityMap    densityMap;
+    BlockAtlas    blockAtlas;
 };
 
 } // namespace GuiBlocks
@@ -0,0 +1,100 @@
+#include "SegmentGrid.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace GuiBlocks {
+
+void SegmentGrid::clear(double cellSize) noexcept
+{
+    cells.clear();
+    this->cellSize = cellSize;
+    valid = false;
+}
+
+void SegmentGrid::insert(uint32_t seq,
+                         uint32_t from,
+                         uint32_t to,
+                         const QPointF &p1,
+                         const QPointF &p2)
+{
+    const Segment segment{seq,from,to};
+    const auto[minx,maxx] = std::minmax({p1.x(),p2.x()});
+    const auto dx = p2.x()-p1.x();
+    const auto dy = p2.y()-p1.y();
+
+    //the segment is walked column by column, and for each column only the
+    //cells covered by the piece of segment inside of it are filled
+    int32_t firstCol,lastCol;
+    cellRange(minx,maxx,firstCol,lastCol);
+    for( auto cx=firstCol ; cx<=lastCol ; cx++ )
+    {
+        double ya,yb;
+        if( std::abs(dx) < tolerance )
+        {
+            //vertical line: all the rows are covered
+            ya = p1.y();
+            yb = p2.y();
+        }
+        else
+        {
+            const auto xa = std::clamp(double(cx)*cellSize    ,minx,maxx);
+            const auto xb = std::clamp(double(cx+1)*cellSize  ,minx,maxx);
+            ya = p1.y()+(xa-p1.x())*dy/dx;
+            yb = p1.y()+(xb-p1.x())*dy/dx;
+        }
+        int32_t firstRow,lastRow;
+        cellRange(std::min(ya,yb),std::max(ya,yb),firstRow,lastRow);
+        for( auto cy=firstRow ; cy<=lastRow ; cy++ )
+            cells[cellKey(cx,cy)].push_back(segment);
+    }
+}
+
+const std::vector<SegmentGrid::Segment>& SegmentGrid::segmentsAt(const QPointF &point) const noexcept
+{
+    static const std::vector<Segment> empty;
+    auto cell = cells.find(cellKey(cellOf(point.x()),cellOf(point.y())));
+    if( cell == cells.end() )
+        return empty;
+    return cell->second;
+}
+
+void SegmentGrid::segmentsIn(const QRectF &rect,std::vector<Segment> &out) const
+{
+    out.clear();
+    const auto area = rect.normalized();
+    int32_t firstCol,lastCol,firstRow,lastRow;
+    cellRange(area.left(),area.right() ,firstCol,lastCol);
+    cellRange(area.top() ,area.bottom(),firstRow,lastRow);
+    for( auto cx=firstCol ; cx<=lastCol ; cx++ )
+        for( auto cy=firstRow ; cy<=lastRow ; cy++ )
+        {
+            auto cell = cells.find(cellKey(cx,cy));
+            if( cell != cells.end() )
+                out.insert(out.end(),cell->second.begin(),cell->second.end());
+        }
+    //a segment crossing several cells is stored in all of them
+    std::sort(out.begin(),out.end(),[](const Segment &a,const Segment &b){ return a.seq < b.seq; });
+    out.erase(std::unique(out.begin(),out.end(),[](const Segment &a,const Segment &b){ return a.seq == b.seq; }),
+              out.end());
+}
+
+uint64_t SegmentGrid::cellKey(int32_t cx,int32_t cy) noexcept
+{
+    return (uint64_t(uint32_t(cx)) << 32) | uint64_t(uint32_t(cy));
+}
+
+int32_t SegmentGrid::cellOf(double val) const noexcept
+{
+    return int32_t(std::floor(val/cellSize));
+}
+
+void SegmentGrid::cellRange(double min,double max,int32_t &first,int32_t &last) const noexcept
+{
+    //the cell c covers [c*cellSize,(c+1)*cellSize], so a value lying
+    //exactly on a border belongs to the two cells sharing it
+    first = int32_t(std::ceil((min-tolerance)/cellSize))-1;
+    last  = int32_t(std::floor((max+tolerance)/cellSize));
+}
+
+} // namespace GuiBlocks
@@ -0,0 +1,65 @@
+#ifndef GUIBLOCKS_SEGMENTGRID_H
+#define GUIBLOCKS_SEGMENTGRID_H
+
+#include <QPointF>
+#include <QRectF>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace GuiBlocks {
+
+//Uniform grid of buckets holding the segments (pair of node indexs) of a link.
+//The node indexes are stored with 32 bits, so any index width of the links fits.
+//A segment is stored in every cell whose (closed) area touches it, so a point
+//query only needs to test the segments of the cell that contains the point.
+//Every segment carries the sequence number it was inserted with, the queries
+//return the segments in that order (which is the iteration order of the tree).
+class SegmentGrid
+{
+public:
+    struct Segment
+    {
+        uint32_t seq;
+        uint32_t from;
+        uint32_t to;
+    };
+
+    SegmentGrid() noexcept {}
+
+    //removes all the segments and sets the size of the cells
+    void clear(double cellSize) noexcept;
+    void insert(uint32_t seq,
+                uint32_t from,
+                uint32_t to,
+                const QPointF &p1,
+                const QPointF &p2);
+    //must be called after the last insert()
+    void finish() noexcept { valid = true; }
+    void invalidate() noexcept { valid = false; }
+    bool isValid() const noexcept { return valid; }
+
+    //segments touching the cell that contains point
+    const std::vector<Segment>& segmentsAt(const QPointF &point) const noexcept;
+    //segments touching any of the cells covered by rect, without duplicates
+    //and sorted by insertion order (out is cleared first)
+    void segmentsIn(const QRectF &rect,std::vector<Segment> &out) const;
+
+private:
+    //the cells are padded with this margin, so the rounding of the divisions
+    //does not miss the segments lying on a cell border (the hit tests of the
+    //links are exact, see GridPoint::cross())
+    static constexpr double tolerance = 1.0e-6;
+    static uint64_t cellKey(int32_t cx,int32_t cy) noexcept;
+    int32_t cellOf(double val) const noexcept;
+    //first and last cell whose closed area touches [min,max]
+    void cellRange(double min,double max,int32_t &first,int32_t &last) const noexcept;
+
+    std::unordered_map<uint64_t,std::vector<Segment>> cells;
+    double cellSize = 1.0;
+    bool valid = false;
+};
+
+} // namespace GuiBlocks
+
+#endif // GUIBLOCKS_SEGMENTGRID_H
@@ -0,0 +1,298 @@
+#include "SegmentKernel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#define GUIBLOCKS_SEGMENTKERNEL_SIMD
+#endif
+
+namespace GuiBlocks {
+
+namespace {
+
+#if defined(__AVX2__)
+//4 segments per iteration
+struct Lanes
+{
+    using Vec = __m256d;
+    static constexpr size_t width = 4;
+    static Vec  load(const double *p) noexcept      { return _mm256_loadu_pd(p); }
+    static void store(double *p,Vec a) noexcept     { _mm256_storeu_pd(p,a); }
+    static Vec  set1(double val) noexcept           { return _mm256_set1_pd(val); }
+    static Vec  add(Vec a,Vec b) noexcept           { return _mm256_add_pd(a,b); }
+    static Vec  sub(Vec a,Vec b) noexcept           { return _mm256_sub_pd(a,b); }
+    static Vec  mul(Vec a,Vec b) noexcept           { return _mm256_mul_pd(a,b); }
+    static Vec  div(Vec a,Vec b) noexcept           { return _mm256_div_pd(a,b); }
+    static Vec  min(Vec a,Vec b) noexcept           { return _mm256_min_pd(a,b); }
+    static Vec  max(Vec a,Vec b) noexcept           { return _mm256_max_pd(a,b); }
+    static Vec  lt(Vec a,Vec b) noexcept            { return _mm256_cmp_pd(a,b,_CMP_LT_OQ); }
+    static Vec  le(Vec a,Vec b) noexcept            { return _mm256_cmp_pd(a,b,_CMP_LE_OQ); }
+    static Vec  eq(Vec a,Vec b) noexcept            { return _mm256_cmp_pd(a,b,_CMP_EQ_OQ); }
+    static Vec  bitAnd(Vec a,Vec b) noexcept        { return _mm256_and_pd(a,b); }
+    static Vec  select(Vec mask,Vec a,Vec b) noexcept{ return _mm256_blendv_pd(b,a,mask); }
+    static int  mask(Vec a) noexcept                { return _mm256_movemask_pd(a); }
+};
+#elif defined(__SSE2__)
+//2 segments per iteration
+struct Lanes
+{
+    using Vec = __m128d;
+    static constexpr size_t width = 2;
+    static Vec  load(const double *p) noexcept      { return _mm_loadu_pd(p); }
+    static void store(double *p,Vec a) noexcept     { _mm_storeu_pd(p,a); }
+    static Vec  set1(double val) noexcept           { return _mm_set1_pd(val); }
+    static Vec  add(Vec a,Vec b) noexcept           { return _mm_add_pd(a,b); }
+    static Vec  sub(Vec a,Vec b) noexcept           { return _mm_sub_pd(a,b); }
+    static Vec  mul(Vec a,Vec b) noexcept           { return _mm_mul_pd(a,b); }
+    static Vec  div(Vec a,Vec b) noexcept           { return _mm_div_pd(a,b); }
+    static Vec  min(Vec a,Vec b) noexcept           { return _mm_min_pd(a,b); }
+    static Vec  max(Vec a,Vec b) noexcept           { return _mm_max_pd(a,b); }
+    static Vec  lt(Vec a,Vec b) noexcept            { return _mm_cmplt_pd(a,b); }
+    static Vec  le(Vec a,Vec b) noexcept            { return _mm_cmple_pd(a,b); }
+    static Vec  eq(Vec a,Vec b) noexcept            { return _mm_cmpeq_pd(a,b); }
+    static Vec  bitAnd(Vec a,Vec b) noexcept        { return _mm_and_pd(a,b); }
+    static Vec  select(Vec mask,Vec a,Vec b) noexcept{ return _mm_or_pd(_mm_and_pd(mask,a),_mm_andnot_pd(mask,b)); }
+    static int  mask(Vec a) noexcept                { return _mm_movemask_pd(a); }
+};
+#endif
+
+constexpr double inf = std::numeric_limits<double>::infinity();
+
+//the running minimums of nearest(). The candidates must be offered in
+//segment order, so on ties the first one is kept
+struct NearestAcc
+{
+    double  nodeDist = inf;
+    double  nodeCode = -1.0;   //2*segment + end
+    double  lineDist = inf;
+    double  lineSeg  = -1.0;
+
+    void offerNode(double dist,double code) noexcept
+    {
+        if( dist < nodeDist || (dist == nodeDist && code < nodeCode) )
+        {
+            nodeDist = dist;
+            nodeCode = code;
+        }
+    }
+    void offerLine(double dist,double seg) noexcept
+    {
+        if( dist < lineDist || (dist == lineDist && seg < lineSeg) )
+        {
+            lineDist = dist;
+            lineSeg  = seg;
+        }
+    }
+};
+
+} // namespace
+
+void SegmentKernel::clear() noexcept
+{
+    x1.clear();
+    y1.clear();
+    x2.clear();
+    y2.clear();
+    from.clear();
+    to.clear();
+    valid = false;
+}
+
+void SegmentKernel::append(uint32_t from,uint32_t to,const GridPoint &p1,const GridPoint &p2)
+{
+    x1.push_back(p1.x);
+    y1.push_back(p1.y);
+    x2.push_back(p2.x);
+    y2.push_back(p2.y);
+    this->from.push_back(from);
+    this->to.push_back(to);
+}
+
+SegmentKernel::Hit SegmentKernel::testPoint(const GridPoint &p1,const GridPoint &p2,const GridPoint &point) noexcept
+{
+    //the rectangle with top-left = p1, and botton-right = p2 will be the working area
+    //and the point should be inside this rectangle, if not, then point is not on the
+    //trajectory between p1 and p2
+    if( point.x < std::min(p1.x,p2.x) || point.x > std::max(p1.x,p2.x) ||
+        point.y < std::min(p1.y,p2.y) || point.y > std::max(p1.y,p2.y) )
+        return Hit::None;
+
+    //if point is exactly a node
+    if( p1 == point )
+        return Hit::First;
+    if( p2 == point )
+        return Hit::Second;
+
+    if( GridPoint::cross(p1,p2,point) == 0 )
+        return Hit::Line;
+    return Hit::None;
+}
+
+int32_t SegmentKernel::findSegmentAt(const GridPoint &point) const noexcept
+{
+    const auto count = size();
+    size_t idx = 0;
+#ifdef GUIBLOCKS_SEGMENTKERNEL_SIMD
+    //same test as testPoint(). The exact node matches are not needed here
+    //since a node is inside the rect and aligned with its segment.
+    //The coordinates are integers in the range of GridPoint, so the cross
+    //product is exact
+    using L = Lanes;
+    const auto px   = L::set1(point.x);
+    const auto py   = L::set1(point.y);
+    const auto zero = L::set1(0.0);
+    for( ; idx+L::width <= count ; idx += L::width )
+    {
+        const auto ax = L::load(&x1[idx]);
+        const auto ay = L::load(&y1[idx]);
+        const auto bx = L::load(&x2[idx]);
+        const auto by = L::load(&y2[idx]);
+        auto inside = L::bitAnd(L::le(L::min(ax,bx),px),L::le(px,L::max(ax,bx)));
+        inside = L::bitAnd(inside,L::bitAnd(L::le(L::min(ay,by),py),L::le(py,L::max(ay,by))));
+        if( L::mask(inside) == 0 )
+            continue;
+        const auto cross = L::sub(L::mul(L::sub(bx,ax),L::sub(py,ay)),
+                                  L::mul(L::sub(by,ay),L::sub(px,ax)));
+        const auto hit = L::bitAnd(inside,L::eq(cross,zero));
+        if( const auto mask = L::mask(hit) )
+        {
+            for( size_t lane=0 ; lane<L::width ; lane++ )
+                if( mask & (1 << lane) )
+                    return int32_t(idx+lane);
+        }
+    }
+#endif
+    for( ; idx<count ; idx++ )
+    {
+        const GridPoint p1(int32_t(x1[idx]),int32_t(y1[idx]));
+        const GridPoint p2(int32_t(x2[idx]),int32_t(y2[idx]));
+        if( testPoint(p1,p2,point) != Hit::None )
+            return int32_t(idx);
+    }
+    return -1;
+}
+
+SegmentKernel::Nearest SegmentKernel::nearest(const GridPoint &gridPos) const noexcept
+{
+    //for every segment: the square distance from pos to its closest end, and
+    //the square distance from pos to its line, if the foot of the perpendicular
+    //falls inside the segment
+    const auto count = size();
+    const auto pos = gridPos.toPointF();
+    size_t idx = 0;
+    NearestAcc acc;
+#ifdef GUIBLOCKS_SEGMENTKERNEL_SIMD
+    using L = Lanes;
+    alignas(32) double laneBase[L::width];
+    for( size_t lane=0 ; lane<L::width ; lane++ )
+        laneBase[lane] = double(lane);
+    const auto base  = L::load(laneBase);
+    const auto px    = L::set1(pos.x());
+    const auto py    = L::set1(pos.y());
+    const auto zero  = L::set1(0.0);
+    const auto one   = L::set1(1.0);
+    const auto two   = L::set1(2.0);
+    const auto vinf  = L::set1(inf);
+    auto nodeDist = vinf;
+    auto nodeCode = L::set1(-1.0);
+    auto lineDist = vinf;
+    auto lineSeg  = L::set1(-1.0);
+    for( ; idx+L::width <= count ; idx += L::width )
+    {
+        const auto seg = L::add(L::set1(double(idx)),base);
+        const auto ax = L::load(&x1[idx]);
+        const auto ay = L::load(&y1[idx]);
+        const auto bx = L::load(&x2[idx]);
+        const auto by = L::load(&y2[idx]);
+        const auto ex = L::sub(px,ax);
+        const auto ey = L::sub(py,ay);
+        const auto fx = L::sub(px,bx);
+        const auto fy = L::sub(py,by);
+        const auto d1 = L::add(L::mul(ex,ex),L::mul(ey,ey));
+        const auto d2 = L::add(L::mul(fx,fx),L::mul(fy,fy));
+        //on ties the first point of the segment wins
+        const auto second = L::lt(d2,d1);
+        const auto dn   = L::select(second,d2,d1);
+        const auto code = L::add(L::mul(seg,two),L::select(second,one,zero));
+        //strict comparison: the lanes keep the first segment on ties
+        const auto nodeBetter = L::lt(dn,nodeDist);
+        nodeDist = L::select(nodeBetter,dn,nodeDist);
+        nodeCode = L::select(nodeBetter,code,nodeCode);
+
+        const auto dx = L::sub(bx,ax);
+        const auto dy = L::sub(by,ay);
+        const auto len = L::add(L::mul(dx,dx),L::mul(dy,dy));
+        const auto t   = L::div(L::add(L::mul(ex,dx),L::mul(ey,dy)),len);
+        const auto inside = L::bitAnd(L::lt(zero,len),L::bitAnd(L::le(zero,t),L::le(t,one)));
+        const auto gx = L::sub(px,L::add(ax,L::mul(t,dx)));
+        const auto gy = L::sub(py,L::add(ay,L::mul(t,dy)));
+        const auto dl = L::select(inside,L::add(L::mul(gx,gx),L::mul(gy,gy)),vinf);
+        const auto lineBetter = L::lt(dl,lineDist);
+        lineDist = L::select(lineBetter,dl,lineDist);
+        lineSeg  = L::select(lineBetter,seg,lineSeg);
+    }
+    //lanes reduction
+    alignas(32) double nd[L::width],nc[L::width],ld[L::width],ls[L::width];
+    L::store(nd,nodeDist);
+    L::store(nc,nodeCode);
+    L::store(ld,lineDist);
+    L::store(ls,lineSeg);
+    for( size_t lane=0 ; lane<L::width ; lane++ )
+    {
+        if( nc[lane] >= 0.0 )
+            acc.offerNode(nd[lane],nc[lane]);
+        if( ls[lane] >= 0.0 )
+            acc.offerLine(ld[lane],ls[lane]);
+    }
+#endif
+    for( ; idx<count ; idx++ )
+    {
+        const auto ex = pos.x()-x1[idx];
+        const auto ey = pos.y()-y1[idx];
+        const auto fx = pos.x()-x2[idx];
+        const auto fy = pos.y()-y2[idx];
+        const auto d1 = ex*ex+ey*ey;
+        const auto d2 = fx*fx+fy*fy;
+        if( d2 < d1 )
+            acc.offerNode(d2,2.0*double(idx)+1.0);
+        else
+            acc.offerNode(d1,2.0*double(idx));
+
+        const auto dx  = x2[idx]-x1[idx];
+        const auto dy  = y2[idx]-y1[idx];
+        const auto len = dx*dx+dy*dy;
+        if( len <= 0.0 )
+            continue;
+        const auto t = (ex*dx+ey*dy)/len;
+        if( t < 0.0 || t > 1.0 )
+            continue;
+        const auto gx = pos.x()-(x1[idx]+t*dx);
+        const auto gy = pos.y()-(y1[idx]+t*dy);
+        acc.offerLine(gx*gx+gy*gy,double(idx));
+    }
+
+    Nearest result;
+    if( acc.nodeCode >= 0.0 )
+    {
+        const auto code = int32_t(acc.nodeCode);
+        result.nodeSegment  = code/2;
+        result.nodeIsSecond = (code%2) != 0;
+        result.nodeDist     = acc.nodeDist;
+    }
+    if( acc.lineSeg >= 0.0 )
+    {
+        const auto seg = size_t(acc.lineSeg);
+        const auto dx  = x2[seg]-x1[seg];
+        const auto dy  = y2[seg]-y1[seg];
+        const auto t   = ((pos.x()-x1[seg])*dx+(pos.y()-y1[seg])*dy)/(dx*dx+dy*dy);
+        result.lineSegment = int32_t(seg);
+        result.lineDist    = acc.lineDist;
+        result.lineFoot    = QPointF(x1[seg]+t*dx,y1[seg]+t*dy);
+    }
+    return result;
+}
+
+} // namespace GuiBlocks
@@ -0,0 +1,74 @@
+#ifndef GUIBLOCKS_SEGMENTKERNEL_H
+#define GUIBLOCKS_SEGMENTKERNEL_H
+
+#include <QPointF>
+#include <cstdint>
+#include <vector>
+#include "GuiBlocks/GridPoint.h"
+
+namespace GuiBlocks {
+
+//Packed copy of the segments of a link (structure of arrays), so the hit tests
+//can check several segments at a time. The queries are vectorized with AVX2 or
+//SSE2 when the compiler targets them, with a scalar fallback otherwise.
+//The points are in grid units (see GridPoint), their range makes the cross
+//products exact in double, so the vectorized tests are exact too.
+//The segments are kept in insertion order (which is the iteration order of the
+//tree) and the queries return the first segment that matches in that order.
+class SegmentKernel
+{
+public:
+    //result of testing a point against a single segment
+    enum class Hit
+    {
+        None,   //point is not on the segment
+        First,  //point is exactly the first point of the segment
+        Second, //point is exactly the second point of the segment
+        Line    //point is on the segment, between its two points
+    };
+    //result of nearest(): the closest node and the closest segment to a point
+    struct Nearest
+    {
+        //the node is given as segment and end (false = first point)
+        int32_t nodeSegment = -1;
+        bool    nodeIsSecond = false;
+        double  nodeDist = 0.0;     //square distance (in grid units)
+        //the segment whose perpendicular from the point falls inside it
+        int32_t lineSegment = -1;
+        double  lineDist = 0.0;     //square distance (in grid units)
+        QPointF lineFoot;           //foot of the perpendicular (in grid units)
+    };
+
+    SegmentKernel() noexcept {}
+
+    void clear() noexcept;
+    void append(uint32_t from,uint32_t to,const GridPoint &p1,const GridPoint &p2);
+    //must be called after the last append()
+    void finish() noexcept { valid = true; }
+    void invalidate() noexcept { valid = false; }
+    bool isValid() const noexcept { return valid; }
+
+    size_t size() const noexcept { return from.size(); }
+    //node indexes of the segment (stored with 32 bits to fit any index width of the links)
+    uint32_t fromIdx(size_t segment) const noexcept { return from[segment]; }
+    uint32_t toIdx(size_t segment) const noexcept { return to[segment]; }
+
+    //index of the first segment that contains point (-1 if none)
+    int32_t findSegmentAt(const GridPoint &point) const noexcept;
+    //closest node and segment to pos (-1 if the kernel is empty)
+    Nearest nearest(const GridPoint &pos) const noexcept;
+
+    //scalar test of a single segment. This is the reference the vectorized
+    //queries follow: the point must be inside the rect spanned by the segment
+    //and aligned with p1 and p2 (null cross product)
+    static Hit testPoint(const GridPoint &p1,const GridPoint &p2,const GridPoint &point) noexcept;
+
+private:
+    std::vector<double> x1,y1,x2,y2;
+    std::vector<uint32_t> from,to;
+    bool valid = false;
+};
+
+} // namespace GuiBlocks
+
+#endif // GUIBLOCKS_SEGMENTKERNEL_H
@@ -0,0 +1,202 @@
+#include "ShadowCache.h"
+
+#include "Style.h"
+#include <algorithm>
+#include <cmath>
+
+namespace GuiBlocks {
+
+std::unordered_map<ShadowCache::Key,QImage,ShadowCache::KeyHash> ShadowCache::sprites;
+
+bool ShadowCache::Key::operator==(const Key &other) const noexcept
+{
+    return width   == other.width   && height  == other.height  &&
+           xRadius == other.xRadius && yRadius == other.yRadius &&
+           blur    == other.blur    && color   == other.color;
+}
+
+size_t ShadowCache::KeyHash::operator()(const Key &key) const noexcept
+{
+    uint64_t hash = 1469598103934665603ull;
+    for( auto val : {uint32_t(key.width),uint32_t(key.height),
+                     uint32_t(key.xRadius),uint32_t(key.yRadius),
+                     uint32_t(key.blur),uint32_t(key.color)} )
+        hash = (hash ^ val) * 1099511628211ull;
+    return size_t(hash);
+}
+
+bool ShadowCache::isVisible(const QPainter *painter) noexcept
+{
+    //the items are not rotated, so m11 is the zoom of the view
+    return painter->worldTransform().m11() >= StyleShadow::minZoom;
+}
+
+QRectF ShadowCache::shadowRect(const QRectF &rect) noexcept
+{
+    const auto blur = StyleShadow::blurRadius;
+    return rect.adjusted(-blur,-blur,blur,blur).translated(StyleShadow::offset);
+}
+
+void ShadowCache::drawRoundedRect(QPainter *painter,
+                                  const QRectF &rect,
+                                  qreal xRadius,
+                                  qreal yRadius,
+                                  const QColor &color)
+{
+    if( !isVisible(painter) )
+        return;
+    //the sprite is built in device pixels, so it is not resampled (on a
+    //high dpi screen the device pixels are devicePixelRatio times smaller)
+    const auto scale = painter->worldTransform().m11()*painter->device()->devicePixelRatioF();
+    const Key key{int32_t(std::lround(rect.width() *scale)),
+                  int32_t(std::lround(rect.height()*scale)),
+                  int32_t(std::lround(xRadius*scale)),
+                  int32_t(std::lround(yRadius*scale)),
+                  std::max(1,int32_t(std::lround(StyleShadow::blurRadius*scale))),
+                  color.rgba()};
+    if( key.width <= 0 || key.height <= 0 )
+        return;
+    painter->drawImage(shadowRect(rect),sprite(key));
+}
+
+void ShadowCache::drawLines(QPainter *painter,
+                            const QVector<QLineF> &lines,
+                            qreal width,
+                            const QColor &color)
+{
+    if( lines.isEmpty() || !isVisible(painter) )
+        return;
+    //a link has its own shape, so its shadow can not be a single sprite:
+    //the sprite is a blurred piece of horizontal line, which is cut in its
+    //left cap, its middle column and its right cap. Each segment is drawn
+    //with a cap at each end and the column stretched between them
+    const auto scale = painter->worldTransform().m11()*painter->device()->devicePixelRatioF();
+    const auto blur  = StyleShadow::blurRadius;
+    //the piece is 2*blur longer than its caps, so the middle column is
+    //out of the reach of the blur of the caps
+    const auto deviceWidth = int32_t(std::lround(width*scale));
+    const auto deviceBlur  = std::max(1,int32_t(std::lround(blur*scale)));
+    const Key key{deviceWidth+2*deviceBlur,
+                  deviceWidth,
+                  deviceWidth/2,
+                  deviceWidth/2,
+                  deviceBlur,
+                  color.rgba()};
+    if( key.width <= 0 || key.height <= 0 )
+        return;
+    const auto &image = sprite(key);
+    //the parts of the sprite, in item units from the center of the cap
+    const int  column = image.width()/2;
+    const auto unit   = 1.0/scale;
+    const auto capX   = (key.blur+key.height/2.0)*unit;
+    const auto top    = -image.height()*unit/2.0;
+    const auto height = image.height()*unit;
+    const auto leftW  = column*unit-capX;
+    const auto rightW = (image.width()-column-1)*unit-capX;
+    const QRectF leftSource(0,0,column,image.height());
+    const QRectF columnSource(column,0,1,image.height());
+    const QRectF rightSource(column+1,0,image.width()-column-1,image.height());
+    const auto transform = painter->transform();
+    painter->save();
+    for( const auto &line : lines )
+    {
+        auto segment = transform;
+        segment.translate(line.x1()+StyleShadow::offset.x(),line.y1()+StyleShadow::offset.y());
+        segment.rotate(-line.angle());
+        painter->setTransform(segment);
+        const auto length = line.length();
+        //the caps of a segment shorter than them are squeezed
+        auto leftEnd    = leftW;
+        auto rightStart = length-rightW;
+        if( rightStart < leftEnd )
+        {
+            leftEnd    = length*leftW/(leftW+rightW);
+            rightStart = leftEnd;
+        }
+        else if( rightStart > leftEnd )
+            painter->drawImage(QRectF(leftEnd,top,rightStart-leftEnd,height),image,columnSource);
+        painter->drawImage(QRectF(-capX,top,leftEnd+capX,height),image,leftSource);
+        painter->drawImage(QRectF(rightStart,top,length+capX-rightStart,height),image,rightSource);
+    }
+    painter->restore();
+}
+
+const QImage &ShadowCache::sprite(const Key &key)
+{
+    if( auto cached = sprites.find(key); cached != sprites.end() )
+        return cached->second;
+    if( sprites.size() >= maxSprites )
+        sprites.clear();
+    return sprites.emplace(key,createSprite(key)).first->second;
+}
+
+QImage ShadowCache::createSprite(const Key &key)
+{
+    //the shape is drawn with a margin of blur pixels, which is the
+    //maximum spread of the box blur below
+    const int margin = key.blur;
+    const int w = key.width +2*margin;
+    const int h = key.height+2*margin;
+    QImage image(w,h,QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    {
+        QPainter painter(&image);
+        painter.setRenderHint(QPainter::Antialiasing);
+        painter.setPen(Qt::NoPen);
+        painter.setBrush(Qt::black);
+        painter.drawRoundedRect(QRectF(margin,margin,key.width,key.height),key.xRadius,key.yRadius);
+    }
+    std::vector<uint8_t> alpha(size_t(w)*size_t(h));
+    for( int y=0 ; y<h ; y++ )
+    {
+        auto line = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+        for( int x=0 ; x<w ; x++ )
+            alpha[size_t(y)*size_t(w)+size_t(x)] = uint8_t(qAlpha(line[x]));
+    }
+    //three box blurs are close to a gaussian blur
+    boxBlur(alpha,w,h,std::max(1,key.blur/3));
+    const auto r = qRed(key.color);
+    const auto g = qGreen(key.color);
+    const auto b = qBlue(key.color);
+    const auto a = qAlpha(key.color);
+    for( int y=0 ; y<h ; y++ )
+    {
+        auto line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for( int x=0 ; x<w ; x++ )
+            line[x] = qPremultiply(qRgba(r,g,b,alpha[size_t(y)*size_t(w)+size_t(x)]*a/255));
+    }
+    return image;
+}
+
+void ShadowCache::boxBlur(std::vector<uint8_t> &alpha,int w,int h,int radius)
+{
+    //each pass is a sliding window sum along one axis (the pixels out of
+    //the image are transparent)
+    std::vector<uint8_t> line(size_t(std::max(w,h)));
+    const int window = 2*radius+1;
+    auto blurLine = [&](uint8_t *data,int length,int stride)
+    {
+        for( int i=0 ; i<length ; i++ )
+            line[size_t(i)] = data[size_t(i)*size_t(stride)];
+        int sum = 0;
+        for( int i=0 ; i<std::min(radius,length) ; i++ )
+            sum += line[size_t(i)];
+        for( int i=0 ; i<length ; i++ )
+        {
+            if( i+radius < length )
+                sum += line[size_t(i+radius)];
+            if( i-radius-1 >= 0 )
+                sum -= line[size_t(i-radius-1)];
+            data[size_t(i)*size_t(stride)] = uint8_t(sum/window);
+        }
+    };
+    for( int pass=0 ; pass<3 ; pass++ )
+    {
+        for( int y=0 ; y<h ; y++ )
+            blurLine(alpha.data()+size_t(y)*size_t(w),w,1);
+        for( int x=0 ; x<w ; x++ )
+            blurLine(alpha.data()+x,h,w);
+    }
+}
+
+} // namespace GuiBlocks
@@ -0,0 +1,75 @@
+#ifndef GUIBLOCKS_SHADOWCACHE_H
+#define GUIBLOCKS_SHADOWCACHE_H
+
+#include <QColor>
+#include <QImage>
+#include <QLineF>
+#include <QPainter>
+#include <QRectF>
+#include <QVector>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace GuiBlocks {
+
+//Shadows shared by all the items, drawn by the items in their paint() (so
+//they do not need a QGraphicsDropShadowEffect, which renders each item
+//offscreen and blurs it on every repaint).
+//The blurred sprites of the rounded rects are built once per device size
+//(zoom times device pixel ratio), rounding, blur and color, and then reused
+//by all the items of that size.
+//The shadows follow StyleShadow (offset and blur in item coordinates) and
+//are not drawn when the zoom is below StyleShadow::minZoom
+class ShadowCache
+{
+public:
+    ShadowCache() = delete;
+
+    //true if the shadows must be drawn with the transform of painter
+    static bool isVisible(const QPainter *painter) noexcept;
+    //area covered by the shadow of rect (in item coordinates)
+    static QRectF shadowRect(const QRectF &rect) noexcept;
+    //shadow of a rounded rect (as QPainter::drawRoundedRect(), absolute radius)
+    static void drawRoundedRect(QPainter *painter,
+                                const QRectF &rect,
+                                qreal xRadius,
+                                qreal yRadius,
+                                const QColor &color);
+    //shadow of a stroke of lines with round caps, drawn with the sprite of
+    //a piece of line stretched along each line
+    static void drawLines(QPainter *painter,
+                          const QVector<QLineF> &lines,
+                          qreal width,
+                          const QColor &color);
+    //releases the sprites (as after a change of StyleShadow)
+    static void clear() noexcept{ sprites.clear(); }
+
+private:
+    struct Key
+    {
+        int32_t width,height;
+        int32_t xRadius,yRadius;
+        int32_t blur;
+        QRgb    color;
+        bool operator==(const Key &other) const noexcept;
+    };
+    struct KeyHash
+    {
+        size_t operator()(const Key &key) const noexcept;
+    };
+    //when the zoom changes the sizes change, so the cache is flushed
+    //when it reaches this number of sprites
+    static constexpr size_t maxSprites = 256;
+
+    static const QImage& sprite(const Key &key);
+    static QImage createSprite(const Key &key);
+    //box blur of a single channel image (w x h), applied in place
+    static void boxBlur(std::vector<uint8_t> &alpha,int w,int h,int radius);
+
+    static std::unordered_map<Key,QImage,KeyHash> sprites;
+};
+
+} // namespace GuiBlocks
+
+#endif // GUIBLOCKS_SHADOWCACHE_H
@@ -1,9 +1,13 @@
 #include "Style.h"
 #include <QColor>
+#include <QPainter>
 #include <QSize>
+#include <QStyleOptionGraphicsItem>
 
 namespace GuiBlocks {
 
+uint32_t Style::currentGeneration = 0;
+
 double StyleText::gapTypeToBorderGridSizePercent = 0.7;
 double StyleText::gapTextToBorderGridSizePercent = 0.25;
 QFont  StyleText::blockTypeFont = QFont("Tahoma", 11);
@@ -13,6 +17,36 @@ QColor StyleText::blockNameColor = Qt::blue;
 QFont  StyleText::blockHintFont = QFont("Tahoma", 11);
 QColor StyleText::blockHintColor = Qt::black;
 
+const QFont& StyleText::font(FontSlot slot) noexcept
+{
+    switch( slot )
+    {
+        case TypeFont:
+            return blockTypeFont;
+        case NameFont:
+            return blockNameFont;
+        default:
+            return blockHintFont;
+    }
+}
+
+void StyleText::setFont(FontSlot slot,const QFont &font)
+{
+    switch( slot )
+    {
+        case TypeFont:
+            blockTypeFont = font;
+            break;
+        case NameFont:
+            blockNameFont = font;
+            break;
+        default:
+            blockHintFont = font;
+            break;
+    }
+    Style::changed();
+}
+
 QSizeF StyleBlockShape::connectorSizeGridSizePercent(0.5,0.7);
 QColor StyleBlockShape::blockRectBorderColor        = "#202020";//Qt::gray;
 QColor StyleBlockShape::blockRectBorderColorOnHover = Qt::black;
@@ -35,6 +69,8 @@ double StyleGrid::fineGridWidth       = 1.0;
 QColor StyleGrid::fineGridColor       = Qt::lightGray;
 double StyleGrid::coarseGridWidth     = 1.0;
 QColor StyleGrid::coarseGridColor     = Qt::gray;
+int    StyleGrid::coarseGridFactor    = 10;
+double StyleGrid::minGridSpacing      = 6.0;
 
 QColor StyleLink::normalColor        = Qt::blue;
 //QColor StyleLink::selectedColor    = Qt::magenta;
@@ -42,6 +78,39 @@ double StyleLink::width              = 2.0;
 QColor StyleLink::shadowColor        = "#202020";
 Qt::PenStyle    StyleLink::normalLine = Qt::SolidLine;
 Qt::PenCapStyle StyleLink::normalCap  = Qt::RoundCap;
+double StyleLink::junctionRadius     = 2.0;
+bool   StyleLink::showDebugInfo      = false;
+
+QPointF StyleShadow::offset     = QPointF(2.0,2.0);
+double  StyleShadow::blurRadius = 15.0;
+double  StyleShadow::minZoom    = 0.5;
+
+StyleLevelOfDetail::Tier StyleLevelOfDetail::tier(const QPainter *painter)
+{
+    const auto lod = QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform());
+    if( lod < flatBelow )
+        return Tier::Flat;
+    if( lod < noTextBelow )
+        return Tier::NoText;
+    return Tier::Full;
+}
+
+double StyleLevelOfDetail::noTextBelow = 0.5;
+double StyleLevelOfDetail::flatBelow   = 0.3;
+double StyleLevelOfDetail::overviewBelow      = 0.1;
+double StyleLevelOfDetail::overviewTilePixels = 16.0;
+
+double StylePan::sceneExtent   = 1.0e6;
+bool   StylePan::kinetic       = true;
+int    StylePan::frameInterval = 16;
+double StylePan::friction      = 0.95;
+double StylePan::minSpeed      = 0.05;
+int    StylePan::flingTimeout  = 50;
+
+bool   StyleZoom::progressive   = true;
+int    StyleZoom::idleTimeout   = 150;
+int    StyleZoom::renderStrips  = 4;
+int    StyleZoom::stripInterval = 16;
 
 QColor StyleSelection::normalFillColor  = Qt::blue;
 QColor StyleSelection::cuttedFillColor  = "#E08000";
@@ -4,14 +4,47 @@
 #include <QFont>
 #include <QColor>
 #include <QLinearGradient>
+#include <QPointF>
+#include <cstdint>
+
+class QPainter;
 
 namespace GuiBlocks {
 
+//The Style values are plain variables, so the code that changes them must
+//call Style::changed() to drop the caches built from them (see TextCache).
+//The setters of the Style classes call it
+class Style
+{
+public:
+    Style() = delete;
+
+    static uint32_t generation() noexcept{ return currentGeneration; }
+    static void changed() noexcept{ currentGeneration++; }
+
+private:
+    static uint32_t currentGeneration;
+};
+
 class StyleText
 {
 public:
     StyleText() = delete;
 
+    //the fonts of the blocks by slot, so the caches are keyed by the slot
+    //and not by QFont::key() (see TextCache)
+    enum FontSlot
+    {
+        TypeFont,
+        NameFont,
+        HintFont,
+        FontsCount
+    };
+    static const QFont& font(FontSlot slot) noexcept;
+    //sets the font of slot, the texts and prototypes laid out with the old
+    //one are built again
+    static void setFont(FontSlot slot,const QFont &font);
+
     static double gapTypeToBorderGridSizePercent;
     static double gapTextToBorderGridSizePercent;
     static QFont  blockTypeFont;
@@ -55,6 +88,10 @@ public:
     static QColor fineGridColor;
     static double  coarseGridWidth;
     static QColor coarseGridColor;
+    //fine grid cells per coarse grid cell
+    static int     coarseGridFactor;
+    //the grids whose lines would be closer than this (in pixels) are not drawn
+    static double  minGridSpacing;
 };
 
 class StyleLink
@@ -67,6 +104,80 @@ public:
     static QColor shadowColor;
     static Qt::PenStyle  normalLine;
     static Qt::PenCapStyle normalCap;
+    static double  junctionRadius;
+    //draws the node indexes and the bounding rect of the links
+    static bool    showDebugInfo;
+};
+
+class StyleShadow
+{
+public:
+    StyleShadow() = delete;
+
+    static QPointF offset;
+    static double  blurRadius;
+    //below this zoom (scale of the view) the shadows are not drawn
+    static double  minZoom;
+};
+
+//How much of the blocks and links is drawn, from the level of detail of
+//the painter (the zoom of the view). The shadows have their own threshold
+//(StyleShadow::minZoom)
+class StyleLevelOfDetail
+{
+public:
+    StyleLevelOfDetail() = delete;
+
+    enum class Tier
+    {
+        Full,   //everything
+        NoText, //no texts, hints nor debug info
+        Flat    //blocks as flat rects and links as 1 pixel polylines
+    };
+    static Tier tier(const QPainter *painter);
+
+    //below these levels of detail the tier drops to NoText and to Flat
+    static double  noTextBelow;
+    static double  flatBelow;
+    //below this zoom the View draws the DensityMap of the scene instead of
+    //the items, with tiles at least this wide (in pixels)
+    static double  overviewBelow;
+    static double  overviewTilePixels;
+};
+
+//Panning of the View (see Panner)
+class StylePan
+{
+public:
+    StylePan() = delete;
+
+    //half the width and height of the scene rect the View scrolls over
+    static double  sceneExtent;
+    //after the release the view keeps scrolling at the speed of the drag,
+    //slowed down every frame by the friction (the fraction of the speed
+    //kept), until it is below minSpeed (pixels per ms)
+    static bool    kinetic;
+    static int     frameInterval;   //ms
+    static double  friction;
+    static double  minSpeed;
+    //a release this long (ms) after the last move does not fling the view
+    static int     flingTimeout;
+};
+
+//Zoom of the View with the wheel (see ProgressiveZoom)
+class StyleZoom
+{
+public:
+    StyleZoom() = delete;
+
+    //while the wheel turns the View shows its last frame scaled, and it is
+    //drawn at the new zoom once the wheel is idle for idleTimeout (ms)
+    static bool    progressive;
+    static int     idleTimeout;
+    //the new frame is drawn in this many strips, one every stripInterval
+    //ms (1 draws it at once)
+    static int     renderStrips;
+    static int     stripInterval;
 };
 
 class StyleSelection
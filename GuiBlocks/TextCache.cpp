@@ -0,0 +1,55 @@
+#include "TextCache.h"
+
+namespace GuiBlocks {
+
+uint32_t TextCache::metricsGeneration = 0;
+std::unique_ptr<QFontMetrics> TextCache::fontMetrics[StyleText::FontsCount];
+
+const TextCache::Text& TextCache::text(const QString &str,StyleText::FontSlot slot)
+{
+    if( generation != Style::generation() )
+    {
+        clear();
+        generation = Style::generation();
+    }
+    auto &slotTexts = texts[slot];
+    if( auto cached = slotTexts.find(str); cached != slotTexts.end() )
+        return cached->second;
+
+    const auto &fm = metrics(slot);
+    Text entry;
+    entry.staticText.setText(str);
+    entry.staticText.setTextFormat(Qt::PlainText);
+    entry.boundingRect = fm.boundingRect(str);
+    entry.advance      = fm.horizontalAdvance(str);
+    entry.ascent       = fm.ascent();
+    return slotTexts.emplace(str,entry).first->second;
+}
+
+void TextCache::draw(QPainter *painter,const QPointF &pos,const QString &str,StyleText::FontSlot slot)
+{
+    const auto &cached = text(str,slot);
+    painter->drawStaticText(pos-QPointF(0.0,cached.ascent),cached.staticText);
+}
+
+void TextCache::clear() noexcept
+{
+    for( auto &slotTexts : texts )
+        slotTexts.clear();
+}
+
+const QFontMetrics& TextCache::metrics(StyleText::FontSlot slot)
+{
+    if( metricsGeneration != Style::generation() )
+    {
+        for( auto &fm : fontMetrics )
+            fm.reset();
+        metricsGeneration = Style::generation();
+    }
+    auto &fm = fontMetrics[slot];
+    if( !fm )
+        fm = std::make_unique<QFontMetrics>(StyleText::font(slot));
+    return *fm;
+}
+
+} // namespace GuiBlocks
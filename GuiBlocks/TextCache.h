@@ -0,0 +1,60 @@
+#ifndef GUIBLOCKS_TEXTCACHE_H
+#define GUIBLOCKS_TEXTCACHE_H
+
+#include <QFont>
+#include <QFontMetrics>
+#include <QPainter>
+#include <QPointF>
+#include <QRectF>
+#include <QStaticText>
+#include <QString>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include "GuiBlocks/Style.h"
+
+namespace GuiBlocks {
+
+//Texts laid out once and drawn many times. Each item owns a TextCache with
+//the QStaticText and the measures of its texts, keyed by string and font
+//slot (see StyleText::FontSlot). The QFontMetrics are shared by all the
+//items (one per font slot).
+//Both caches are dropped when Style::generation() changes
+class TextCache
+{
+public:
+    struct Text
+    {
+        QStaticText staticText;
+        QRectF      boundingRect;   //as QFontMetrics::boundingRect()
+        double      advance;        //as QFontMetrics::horizontalAdvance()
+        double      ascent;         //distance from the top to the baseline
+    };
+
+    //str laid out with the font of slot (the reference is valid until the
+    //next call)
+    const Text& text(const QString &str,StyleText::FontSlot slot);
+    //draws str with its baseline starting at pos, as QPainter::drawText()
+    //(the painter font must be the one of slot)
+    void draw(QPainter *painter,const QPointF &pos,const QString &str,StyleText::FontSlot slot);
+    void clear() noexcept;
+
+    //process wide metrics of the font of slot (valid until the style changes)
+    static const QFontMetrics& metrics(StyleText::FontSlot slot);
+
+private:
+    struct KeyHash
+    {
+        size_t operator()(const QString &key) const noexcept{ return size_t(qHash(key)); }
+    };
+
+    uint32_t generation = 0;
+    std::unordered_map<QString,Text,KeyHash> texts[StyleText::FontsCount];
+
+    static uint32_t metricsGeneration;
+    static std::unique_ptr<QFontMetrics> fontMetrics[StyleText::FontsCount];
+};
+
+} // namespace GuiBlocks
+
+#endif // GUIBLOCKS_TEXTCACHE_H
@@ -6,9 +6,13 @@
 
 //std includes
 #include <cmath>
+#include <utility>
 
 //Qt includes
+#include <QElapsedTimer>
 #include <QMouseEvent>
+#include <QPaintEvent>
+#include <QPainter>
 #include <QGraphicsItem>
 #include <QDebug>
 
@@ -17,7 +21,9 @@ namespace GuiBlocks {
 View::View(QWidget *parent)
     : QGraphicsView(parent),
       scene(parent),
-      uiSM(this)
+      uiSM(this),
+      panner(this),
+      progressiveZoom(this)
 {
     //setMouseTracking(true);
     //setViewportUpdateMode(QGraphicsView::FullViewportUpdate);
@@ -33,12 +39,15 @@ View::View(QWidget *parent)
     brush.setStyle(Qt::BrushStyle::SolidPattern);
     setBackgroundBrush(brush);
 
-    //call setItemIndexMethod with NoIndex is necessary to void crashes
-    //when deleting (manually) the links removed from the scene.
-    //It seems that the scene keeps reference to the links
-    //after removing it in the BSPItemIndexMethod
-    scene.setItemIndexMethod(QGraphicsScene::ItemIndexMethod::NoIndex);
     QGraphicsView::setScene(&scene);
+    //panned with the mouse (see Panner), the scroll bars only move the view
+    const auto extent = StylePan::sceneExtent;
+    setSceneRect(-extent,-extent,2.0*extent,2.0*extent);
+    setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+
+    //the static items changed by an edit are drawn again in the layers
+    connect(&scene,&Scene::appearanceChanged,[this](QGraphicsItem *item){ compositor.invalidate(item); });
 }
 
 void View::addBlock()
@@ -143,78 +152,38 @@ void View::showCurrentLinkData()
 void View::drawBackground(QPainter* painter, const QRectF &r)
 {
     QGraphicsView::drawBackground( painter , r );
-
-    auto drawGrid = [&](double gridStep)
-    {
-        QRect   windowRect = rect();
-        QPointF tl = mapToScene(windowRect.topLeft());
-        QPointF br = mapToScene(windowRect.bottomRight());
-
-        double left   = std::floor(tl.x() / gridStep - 0.5);
-        double right  = std::floor(br.x() / gridStep + 1.0);
-        double bottom = std::floor(tl.y() / gridStep - 0.5);
-        double top    = std::floor (br.y() / gridStep + 1.0);
-
-        // vertical lines
-        for (int xi = int(left); xi <= int(right); ++xi)
-        {
-            QLineF line(xi * gridStep, bottom * gridStep,
-                        xi * gridStep, top * gridStep );
-
-            painter->drawLine(line);
-        }
-
-        // horizontal lines
-        for (int yi = int(bottom); yi <= int(top); ++yi)
-        {
-            QLineF line(left * gridStep, yi * gridStep,
-                        right * gridStep, yi * gridStep );
-            painter->drawLine(line);
-        }
-    };
-
-    //  auto const &flowViewStyle = StyleCollection::flowViewStyle();
-
-    QPen pfine(StyleGrid::fineGridColor,
-               qreal(StyleGrid::fineGridWidth));
-
-    painter->setPen(pfine);
-    drawGrid(qreal(StyleGrid::gridSize));
-
-    QPen p(StyleGrid::coarseGridColor,
-           qreal(StyleGrid::coarseGridWidth));
-
-    painter->setPen(p);
-    drawGrid(10.0*qreal(StyleGrid::gridSize));
+    gridRenderer.draw(painter,r);
 }
 
 void View::mousePressEvent(QMouseEvent *event)
 {
+    progressiveZoom.finish();
     QGraphicsView::mousePressEvent(event);
 
     //This apply panView: middle mouse btn, or Alt + Left Click
     if( ((event->modifiers() == Qt::NoModifier)  && (event->buttons() == Qt::MiddleButton))  ||
         ((event->modifiers() == Qt::AltModifier) && (event->buttons() == Qt::LeftButton)) )
     {
-        panViewClicPos = mapToScene(event->pos());
+        panner.press(event->pos());
         return;
     }
-
+    //a click stops the kinetic panning
+    panner.stop();
     uiSM.mousePress(event);
 }
 
 void View::mouseMoveEvent(QMouseEvent *event)
 {
+    //the hover alone does not need the new zoom
+    if( event->buttons() != Qt::NoButton || uiSM.st != UserInterfaceStateMachine::States::waitPress )
+        progressiveZoom.finish();
     QGraphicsView::mouseMoveEvent(event);
-    //this apply panView
-    if( ((event->modifiers() == Qt::NoModifier)  && (event->buttons() == Qt::MiddleButton)) ||
-        ((event->modifiers() == Qt::AltModifier) && (event->buttons() == Qt::LeftButton)) )
-    {
-        QPointF difference = panViewClicPos - mapToScene(event->pos());
-        setSceneRect(sceneRect().translated(difference.x(), difference.y()));
-    }
+    //this apply panView: scrolls the pixels already drawn
+    if( panner.isPanning() )
+        panner.move(event->pos());
     emit updateCoords(mapToScene(event->pos()));
     uiSM.mouseMove(event);
+    updateLayers();
 }
 
 void View::mouseDoubleClickEvent(QMouseEvent *event)
@@ -222,61 +191,153 @@ void View::mouseDoubleClickEvent(QMouseEvent *event)
     Q_UNUSED(event)
     if( event->buttons() == Qt::LeftButton )
     {
+        progressiveZoom.finish();
         uiSM.mouseDoubleClick(event);
+        updateLayers();
     }
 }
 
 void View::keyPressEvent(QKeyEvent *event)
 {
+    progressiveZoom.finish();
     QGraphicsView::keyPressEvent(event);
     uiSM.keyPress(event);
+    updateLayers();
 }
 
 void View::mouseReleaseEvent(QMouseEvent *event)
 {
+    progressiveZoom.finish();
     QGraphicsView::mouseReleaseEvent(event);
+    panner.release();
     //if( (event->modifiers() == Qt::NoModifier) && (event->button() == Qt::LeftButton) )
         uiSM.mouseRelease(event);
+    updateLayers();
 }
 
 void View::resizeEvent(QResizeEvent *event)
 {
+    progressiveZoom.finish();
     QGraphicsView::resizeEvent(event);
+    updateLayers();
 }
 
 void View::wheelEvent(QWheelEvent *event)
 {
     qreal scaleFactor = 1.1;
+    //the kinetic scrolling would move the preview
+    panner.stop();
+    const double zoom = progressiveZoom.targetZoom();
     if( event->angleDelta().y() > 0.0 )
     {
-        if( transform().m11() < 2.0 )
-            scale( scaleFactor , scaleFactor );
+        if( zoom >= 2.0 )
+            return;
     }
     else
     {
-        if( transform().m11() > 0.2 )
-            scale( 1.0/scaleFactor , 1.0/scaleFactor );
+        //far enough to see the whole plant (see drawFrame())
+        if( zoom <= 0.02 )
+            return;
+        scaleFactor = 1.0/scaleFactor;
     }
+    if( StyleZoom::progressive )
+        progressiveZoom.zoom(scaleFactor,event->position());
+    else
+        scale( scaleFactor , scaleFactor );
+    updateLayers();
 //    rect();
 //    setSceneRect(QRectF(0,0,25000,25000));
 //    qDebug() << this->sceneRect();
 //    scene.addRect(sceneRect());
 }
 
-//void View::paintEvent(QPaintEvent *event)
-//{
-//    QGraphicsView::paintEvent(event);
-//}
+void View::paintEvent(QPaintEvent *event)
+{
+    if( !progressiveZoom.isActive() )
+    {
+        drawFrame(event);
+        return;
+    }
+    //the strips of the new zoom not drawn yet show the preview
+    const QRegion region = progressiveZoom.drawPreview(event->region());
+    if( region.isEmpty() )
+        return;
+    QPaintEvent strip(region);
+    drawFrame(&strip);
+}
+
+void View::drawFrame(QPaintEvent *event)
+{
+    QElapsedTimer timer;
+    timer.start();
+    //the view is not rotated, so m11 is its zoom
+    if( transform().m11() < StyleLevelOfDetail::overviewBelow )
+    {
+        //the items would be a few pixels wide: the cost of the density map
+        //depends on the tiles on screen and not on the number of items
+        QPainter painter(viewport());
+        const QRectF exposed = mapToScene(event->rect()).boundingRect();
+        painter.setClipRegion(event->region());
+        painter.setTransform(viewportTransform());
+        drawBackground(&painter,exposed);
+        scene.getDensityMap().draw(&painter,exposed);
+    }
+    else if( compositor.isActive() && !compositor.isStale() && compositor.isReady(event->rect()) )
+    {
+        //the static items are in the tiles, only the edited ones are drawn
+        QPainter painter(viewport());
+        painter.setRenderHints(renderHints());
+        painter.setClipRegion(event->region());
+        painter.setTransform(viewportTransform());
+        drawBackground(&painter,mapToScene(event->rect()).boundingRect());
+        painter.resetTransform();
+        compositor.draw(&painter,event->rect());
+    }
+    else
+        QGraphicsView::paintEvent(event);
+    if( !activeItems.empty() )
+        frameStats.add(double(timer.nsecsElapsed())/1.0e6);
+}
+
+void View::moveBlockToFront(Block *block)
+{
+    //only the block changes its z value (see ZOrderManager)
+    scene.getZOrder().raise(block);
+}
 
-void View::moveBlockToFront(Block *block) const
+void View::updateLayers()
 {
-    auto itemlist = items();
-    auto maxZ = itemlist.size()-1;
-    block->setZValue(qreal(maxZ));
-    auto z = 0;
-    for( auto item = itemlist.end()-1 ; item >= itemlist.begin() ; --item )
-        if( *item != block )
-            (*item)->setZValue(z++);
+    activeItems.clear();
+    uiSM.getActiveItems(activeItems);
+    if( activeItems.empty() )
+    {
+        if( frameStats.count() != 0 )
+        {
+            std::swap(lastEditFrames,frameStats);
+            frameStats.clear();
+        }
+        if( compositor.isActive() )
+        {
+            //the edit is committed: the static items it changed (as the
+            //connected ports) are drawn again
+            compositor.end();
+            viewport()->update();
+        }
+        return;
+    }
+    //the scrolling view is drawn without layers (the tiles are stale)
+    //until it stops
+    if( panner.isActive() )
+        return;
+    //the overview does not draw the items
+    if( transform().m11() < StyleLevelOfDetail::overviewBelow )
+    {
+        compositor.end();
+        return;
+    }
+    if( compositor.isActive() && !compositor.isStale() && compositor.hasActiveItems(activeItems) )
+        return;
+    compositor.begin(this,activeItems);
 }
 
 QPointF View::mapToBlock(const Block *block, const QPoint &mousePos) const
@@ -302,7 +363,15 @@ void View::UserInterfaceStateMachine::mousePress(QMouseEvent *event)
         auto pos = nextGridPosition(parent->mapToScene(event->pos()),StyleGrid::gridSize);
         startPos = pos;
         prevPos = pos;
-        activeItem = getItemUnderMouse(event->pos(),false);
+        const auto hit = getItemUnderMouse(event->pos(),false);
+        if( hit.port )
+            activeItem = hit.port;
+        else if( hit.block )
+            activeItem = hit.block;
+        else if( hit.link )
+            activeItem = hit.link;
+        else
+            activeItem.reset();
         if( activeItem )
             switch( static_cast<ActiveItemIdx>(activeItem.value().index()) )
             {
@@ -312,7 +381,8 @@ void View::UserInterfaceStateMachine::mousePress(QMouseEvent *event)
                     lastLink = std::get<ActiveItemIdx::LinkIdx>(activeItem.value());
                     break;
                 case ActiveItemIdx::BlockIdx:
-                    parent->moveBlockToFront(std::get<ActiveItemIdx::BlockIdx>(activeItem.value()));
+                    draggedBlock = std::get<ActiveItemIdx::BlockIdx>(activeItem.value());
+                    parent->moveBlockToFront(draggedBlock);
                     break;
             }
         st = States::triggerAction;
@@ -476,6 +546,7 @@ void View::UserInterfaceStateMachine::mouseMove(QMouseEvent *event)
                 selectionShapePtr->setPen(pen);
                 selectionShapePtr->setBrush(brush);
                 selectionShapePtr->setOpacity(StyleSelection::opacity);
+                selectionShapePtr->setZValue(ZOrderManager::overlayZ());
             }
             selectionShapePtr->setPath(selectionShape);
             selectionShapePtr->update();
@@ -546,6 +617,7 @@ void View::UserInterfaceStateMachine::mouseMove(QMouseEvent *event)
 
 void View::UserInterfaceStateMachine::mouseRelease(QMouseEvent *event)
 {
+    draggedBlock = nullptr;
     if( st == States::triggerAction )
     {
         if( activeItem )
@@ -691,71 +763,29 @@ void View::UserInterfaceStateMachine::showCurrentLinkData() const
     qDebug() << "--------------------------------------- ";
 }
 
-std::optional<std::variant<Block::Port*,Block*,Link*>>
-View::UserInterfaceStateMachine::getItemUnderMouse(const QPoint &mousePos,
-                                                   bool gridPosition) const
+void View::UserInterfaceStateMachine::getActiveItems(std::vector<QGraphicsItem*> &items) const
 {
-    auto items = parent->scene.items(parent->mapToScene(mousePos));
-    //The top item will be retrieved in the following order:
-    //1- block port
-    //2- block (dragArea)
-    //3- link
-    //This means that if under the mousePos there are multiple objects of interest,
-    //it will first return the block port, if there is not block port, then a block
-    //and finally a link.
-    for( auto& item : items )
+    if( draggedBlock )
     {
-        Block *block = dynamic_cast<Block*>(item);
-        if( block )
-        {
-            Block::Port* port = block->isMouseOverPort(parent->mapToBlock(block,mousePos));
-            if( port )
-                return port;
-            if( block->isMouseOverBlock(parent->mapToBlock(block,mousePos)) )
-                return block;
-        }
-        if( auto link = dynamic_cast<Link*>(item) )
-        {
-            if( gridPosition )
-            {
-                if( link->isPartOfLink(nextGridPosition(parent->mapToScene(mousePos),StyleGrid::gridSize)) /*link->containsPoint(parent->mapToScene(mousePos))*/ )
-                    return link;
-            }
-            else
-            {
-                QRectF rect;
-                rect.setHeight(StyleGrid::gridSize);
-                rect.setWidth(StyleGrid::gridSize);
-                rect.moveCenter(parent->mapToScene(mousePos));
-                if( link->isPartOfLink(rect) )
-                    return link;
-            }
-        }
+        items.push_back(draggedBlock);
+        draggedBlock->getConnectedLinks(items);
+        return;
     }
-    return {};
+    if( activeItem && static_cast<ActiveItemIdx>(activeItem.value().index()) == ActiveItemIdx::LinkIdx )
+        items.push_back(std::get<ActiveItemIdx::LinkIdx>(activeItem.value()));
 }
 
-std::vector<Link*> View::UserInterfaceStateMachine::getLinksUnderMouse(const QPoint &mousePos,bool gridPosition) const
+HitTester::Result View::UserInterfaceStateMachine::getItemUnderMouse(const QPoint &mousePos,
+                                                                     bool gridPosition) const
 {
-//    qDebug() << parent->mapToScene(mousePos);
-    auto items = parent->scene.items(parent->mapToScene(mousePos));
-//    qDebug() << "items.size()" << items.size();
-    std::vector<Link*> links;
-    for( auto& item : items )
-        if( auto link = dynamic_cast<Link*>(item) )
-        {
-            if( gridPosition )
-            {
-                if( link->isPartOfLink(nextGridPosition(parent->mapToScene(mousePos),StyleGrid::gridSize)) /*link->containsPoint(parent->mapToScene(mousePos))*/ )
-                    links.push_back(link);
-            }
-            else
-            {
-                if( link->isPartOfLink( parent->mapToScene(mousePos)) )
-                    links.push_back(link);
-            }
-        }
-    return links;
+    //the port is returned before its block, and the block before a link
+    //(see HitTester::itemAt())
+    return parent->scene.getHitTester().itemAt(parent->mapToScene(mousePos),gridPosition);
+}
+
+const std::vector<Link*>& View::UserInterfaceStateMachine::getLinksUnderMouse(const QPoint &mousePos,bool gridPosition) const
+{
+    return parent->scene.getHitTester().linksAt(parent->mapToScene(mousePos),gridPosition);
 }
 
 void View::UserInterfaceStateMachine::updateActiveLine(const QPointF &pos)
@@ -2,6 +2,11 @@
 #define VIEW_H
 
 #include <QGraphicsView>
+#include "GuiBlocks/FrameStats.h"
+#include "GuiBlocks/GridRenderer.h"
+#include "GuiBlocks/LayerCompositor.h"
+#include "GuiBlocks/Panner.h"
+#include "GuiBlocks/ProgressiveZoom.h"
 #include "GuiBlocks/Scene.h"
 #include "GuiBlocks/Block.h"
 #include "GuiBlocks/Link.h"
@@ -21,6 +26,9 @@ public:
     void flipLastBlock();
     void setDebugText(const QString &text);
     void showCurrentLinkData();
+    Scene& getScene() { return scene; }
+    //paint times of the frames of the last finished edit (as a drag)
+    const FrameStats& getLastEditFrames() const { return lastEditFrames; }
 
 protected:
     void drawBackground(QPainter* painter, const QRectF &r) override;
@@ -31,15 +39,23 @@ protected:
     void wheelEvent(QWheelEvent *event) override;
     void mouseDoubleClickEvent(QMouseEvent *event) override;
     void keyPressEvent(QKeyEvent *event) override;
+    //while the wheel turns it draws the preview of the ProgressiveZoom
+    void paintEvent(QPaintEvent *event) override;
 
 protected slots:
-    //void paintEvent(QPaintEvent *event) override;
 
 signals:
     void updateCoords(const QPointF&);
 
 private: //internals methods
-    void moveBlockToFront(Block* block) const;
+    void moveBlockToFront(Block* block);
+    //starts, rebuilds or ends the static layer of the compositor after
+    //the events that change the edited items
+    void updateLayers();
+    //below StyleLevelOfDetail::overviewBelow it draws the DensityMap of
+    //the scene instead of the items. While an edit is in progress it draws
+    //the layers of the LayerCompositor
+    void drawFrame(QPaintEvent *event);
     Block::Port* getBlockPortUnderMouse(QList<QGraphicsItem*> &items,
                                         const QPoint& mousePos) const;
 
@@ -74,6 +90,9 @@ private: //internal types
         void switchLinkPath();
 
         void showCurrentLinkData()const;
+        //the items being edited: the dragged block and its links, or the
+        //link being drawn or moved
+        void getActiveItems(std::vector<QGraphicsItem*> &items) const;
     private: //internal methods
         enum ActiveItemIdx  //to be used with std::optional<...> activeItem
         {
@@ -81,8 +100,9 @@ private: //internal types
             BlockIdx,
             LinkIdx
         };
-        std::optional<std::variant<Block::Port*,Block*,Link*>> getItemUnderMouse(const QPoint &mousePos,bool gridPosition=true) const;
-        std::vector<Link*> getLinksUnderMouse(const QPoint &mousePos,bool gridPosition=true) const;
+        HitTester::Result getItemUnderMouse(const QPoint &mousePos,bool gridPosition=true) const;
+        //the vector is reused by the next call
+        const std::vector<Link*>& getLinksUnderMouse(const QPoint &mousePos,bool gridPosition=true) const;
         void updateActiveLine(const QPointF &pos);
         void removeLinkFromScene();
     private:
@@ -96,6 +116,7 @@ private: //internal types
         QGraphicsPathItem *selectionShapePtr = nullptr;
         QList<QGraphicsItem*> itemsSelected;
         Link* lastLink = nullptr;
+        Block* draggedBlock = nullptr;  //moved by QGraphicsView until the release
     };//class UserInterfaceStateMachine
 
 private:
@@ -103,7 +124,13 @@ private:
 //    QGraphicsScene scene;
     UserInterfaceStateMachine uiSM;
     std::vector<Link*> links;
-    QPointF panViewClicPos;
+    Panner panner;
+    GridRenderer gridRenderer;
+    LayerCompositor compositor;
+    std::vector<QGraphicsItem*> activeItems;    //kept to reuse the storage
+    FrameStats frameStats;  //of the current edit
+    FrameStats lastEditFrames;
+    ProgressiveZoom progressiveZoom;
 
 private://debug helpers
     struct DebugType
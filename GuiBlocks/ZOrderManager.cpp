@@ -0,0 +1,111 @@
+#include "ZOrderManager.h"
+
+#include "TypeID.h"
+#include <algorithm>
+#include <limits>
+
+namespace GuiBlocks {
+
+ZOrderManager::ZOrderManager()
+{
+    for( int band=0 ; band<BandsCount ; band++ )
+        bands[band].next = bandBase(band);
+    renumberTimer.setInterval(0);
+    QObject::connect(&renumberTimer,&QTimer::timeout,[this]{ step(); });
+}
+
+void ZOrderManager::insert(QGraphicsItem *item)
+{
+    bands[bandOf(item)].items.insert(item);
+    raise(item);
+}
+
+void ZOrderManager::remove(const QGraphicsItem *item)
+{
+    auto &band = bands[bandOf(item)];
+    band.items.erase(const_cast<QGraphicsItem*>(item));
+    //the queued entries of item are skipped by renumber()
+    for( size_t i=band.processed ; i<band.pending.size() ; i++ )
+        if( band.pending[i].item == item )
+            band.pending[i].item = nullptr;
+}
+
+void ZOrderManager::raise(QGraphicsItem *item)
+{
+    const int idx = bandOf(item);
+    auto &band = bands[idx];
+    //already on top
+    if( band.next > bandBase(idx) && item->zValue() == band.next-1.0 )
+        return;
+    if( band.next >= bandBase(idx)+bandSize )
+    {
+        if( band.pending.empty() )
+            startRenumbering(idx);
+        renumber(idx,std::numeric_limits<size_t>::max());
+    }
+    const double z = band.next++;
+    item->setZValue(z);
+    if( !band.pending.empty() )
+        band.pending.push_back({item,z});
+    else if( band.next-bandBase(idx) >= bandSize/2.0 )
+        startRenumbering(idx);
+}
+
+int ZOrderManager::bandOf(const QGraphicsItem *item)
+{
+    return item->type() == TypeID::LinkID ? LinksBand : BlocksBand;
+}
+
+void ZOrderManager::startRenumbering(int idx)
+{
+    auto &band = bands[idx];
+    band.pending.clear();
+    band.pending.reserve(band.items.size());
+    for( auto item : band.items )
+        band.pending.push_back({item,item->zValue()});
+    std::sort(band.pending.begin(),band.pending.end(),
+              [](const Pending &a,const Pending &b){ return a.z < b.z; });
+    band.processed = 0;
+    band.renumbered = bandBase(idx);
+    if( band.pending.empty() )
+    {
+        band.next = band.renumbered;
+        return;
+    }
+    renumberTimer.start();
+}
+
+void ZOrderManager::renumber(int idx,size_t count)
+{
+    //the live entries are queued with increasing z values, all of them
+    //integers of the band, so the k-th one is at least base+k and the
+    //renumbered items stay below the ones that are still queued
+    auto &band = bands[idx];
+    for( ; count>0 && band.processed<band.pending.size() ; count--, band.processed++ )
+    {
+        const auto &entry = band.pending[band.processed];
+        if( entry.item && entry.item->zValue() == entry.z )
+            entry.item->setZValue(band.renumbered++);
+    }
+    if( band.processed < band.pending.size() )
+        return;
+    //every item of the band has been renumbered below band.renumbered
+    band.next = band.renumbered;
+    band.pending.clear();
+    band.processed = 0;
+}
+
+void ZOrderManager::step()
+{
+    bool busy = false;
+    for( int idx=0 ; idx<BandsCount ; idx++ )
+        if( !bands[idx].pending.empty() )
+        {
+            renumber(idx,renumberStep);
+            busy = busy || !bands[idx].pending.empty();
+        }
+    if( !busy )
+        renumberTimer.stop();
+}
+
+} // namespace GuiBlocks
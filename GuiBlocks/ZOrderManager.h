@@ -0,0 +1,76 @@
+#ifndef GUIBLOCKS_ZORDERMANAGER_H
+#define GUIBLOCKS_ZORDERMANAGER_H
+
+#include <QGraphicsItem>
+#include <QTimer>
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+namespace GuiBlocks {
+
+//Stacking order of the blocks and links of a Scene. Each kind of item has
+//its own band of z values (the links below the blocks), and raise() puts
+//an item on top of its band by giving it the next value of the band, so
+//only that item changes its z value. When half of a band has been handed
+//out, the items of the band are renumbered from the bottom of the band,
+//keeping their order, a few at a time from a timer (the raises done
+//meanwhile go on top as usual). The band is only renumbered at once if it
+//runs out of values before the timer finishes.
+//The overlays of the views (as the selection rectangle) are put above
+//every band with overlayZ()
+class ZOrderManager
+{
+public:
+    ZOrderManager();
+
+    //a new item is placed on top of its band
+    void insert(QGraphicsItem *item);
+    void remove(const QGraphicsItem *item);
+    void raise(QGraphicsItem *item);
+    //z of the items drawn over the blocks and links (they are not raised)
+    static double overlayZ() noexcept { return bandBase(OverlayBand); }
+
+private:
+    enum Band
+    {
+        LinksBand,
+        BlocksBand,
+        BandsCount,
+        //above the managed bands
+        OverlayBand = BandsCount
+    };
+    struct Pending
+    {
+        QGraphicsItem *item;
+        double         z;   //z of item when queued, it is stale if item was raised again
+    };
+    struct BandState
+    {
+        double next;
+        std::unordered_set<QGraphicsItem*> items;
+        //renumbering in progress (queued from bottom to top)
+        std::vector<Pending> pending;
+        size_t processed = 0;
+        double renumbered = 0;  //next value of the renumbering
+    };
+
+    static constexpr double bandSize = double(1 << 22);
+    //items renumbered per timer step
+    static constexpr size_t renumberStep = 256;
+
+    static int bandOf(const QGraphicsItem *item);
+    static double bandBase(int band) noexcept { return double(band)*bandSize; }
+    void startRenumbering(int band);
+    //renumbers up to count queued items, and finishes the renumbering when
+    //the queue is empty
+    void renumber(int band,size_t count);
+    void step();
+
+    BandState bands[BandsCount];
+    QTimer    renumberTimer;
+};
+
+} // namespace GuiBlocks
+
+#endif // GUIBLOCKS_ZORDERMANAGER_H
@@ -0,0 +1,88 @@
+#include <QtTest>
+#include "GuiBlocks/Block.h"
+#include "GuiBlocks/BlockPrototype.h"
+#include "GuiBlocks/Link.h"
+#include "GuiBlocks/Scene.h"
+#include "GuiBlocks/View.h"
+
+using namespace GuiBlocks;
+
+//Paint times of a block dragged across a large scene, as recorded by the
+//View (see View::getLastEditFrames()). It prints the median and the p99
+//of the frames, it only fails if the frames were not recorded
+class DragBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    //a grid of 10000 blocks, each one with a link from its output, and
+    //one of them dragged with the mouse for 200 frames
+    void dragOnLargeScene();
+};
+
+void DragBenchmark::dragOnLargeScene()
+{
+    constexpr int columns = 100;
+    constexpr int rows    = 100;
+    constexpr int steps   = 200;
+    const QPointF spacing(300.0,200.0);
+
+    View view;
+    view.resize(1280,800);
+    auto &scene = view.getScene();
+    auto prototype = BlockPrototype::get("FIR",{{Block::PortDir::Input,"Double","In"},
+                                                {Block::PortDir::Output,"Double","Out"}});
+    Block *dragged = nullptr;
+    for( int row=0 ; row<rows ; row++ )
+        for( int column=0 ; column<columns ; column++ )
+        {
+            auto block = new Block(prototype,"fir "+QString::number(row*columns+column));
+            block->setPos(column*spacing.x(),row*spacing.y());
+            scene.addItem(block);
+            auto port = block->isMouseOverPort(prototype->getConnector(block->getBlockOrientation(),1).hitRect.center());
+            QVERIFY(port != nullptr);
+            const QPointF anchor = block->getPortConnectionPoint(*port);
+            auto link = new Link(anchor);
+            link->insertLineAt(anchor,anchor+QPointF(spacing.x()/2.0,spacing.y()/2.0),
+                               Link::LinkPath::horizontalThenVertical);
+            link->connectLinkToPortAtLastInsertedLine(port,true);
+            scene.addItem(link);
+            if( row == rows/2 && column == columns/2 )
+                dragged = block;
+        }
+    QVERIFY(dragged != nullptr);
+
+    view.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&view));
+    view.centerOn(dragged);
+    QCoreApplication::processEvents();
+
+    //the events are sent to the viewport as the ones of a real drag, and
+    //each move is painted at once (as it would be on the next frame)
+    const QPointF grabbed = dragged->mapToScene(dragged->boundingRect().center());
+    QVERIFY(dragged->isMouseOverPort(dragged->boundingRect().center()) == nullptr);
+    auto send = [&](QEvent::Type type,const QPointF &scenePos,Qt::MouseButton button,Qt::MouseButtons buttons)
+    {
+        const QPointF pos = view.mapFromScene(scenePos);
+        QMouseEvent event(type,pos,view.viewport()->mapToGlobal(pos),button,buttons,Qt::NoModifier);
+        QCoreApplication::sendEvent(view.viewport(),&event);
+    };
+    send(QEvent::MouseButtonPress,grabbed,Qt::LeftButton,Qt::LeftButton);
+    for( int step=1 ; step<=steps ; step++ )
+    {
+        //back and forth around the grab point, so the block stays on screen
+        const QPointF offset(((step%40)-20)*10.0,((step/40)%5-2)*40.0);
+        send(QEvent::MouseMove,grabbed+offset,Qt::NoButton,Qt::LeftButton);
+        view.viewport()->repaint();
+    }
+    send(QEvent::MouseButtonRelease,grabbed,Qt::LeftButton,Qt::NoButton);
+
+    const auto &frames = view.getLastEditFrames();
+    QVERIFY(frames.count() >= size_t(steps));
+    qInfo("drag of a block over %d items, %d frames: median %.3f ms, p99 %.3f ms",
+          int(scene.items().size()),int(frames.count()),frames.percentile(0.5),frames.percentile(0.99));
+}
+
+QTEST_MAIN(DragBenchmark)
+
+#include "tst_dragbenchmark.moc"
@@ -0,0 +1,73 @@
+#include <QtTest>
+#include "GuiBlocks/Block.h"
+#include "GuiBlocks/BlockPrototype.h"
+#include "GuiBlocks/Link.h"
+#include "GuiBlocks/Scene.h"
+
+using namespace GuiBlocks;
+
+//Regression tests of the hit tests of a Scene (see HitTester) against the
+//items deleted while they are being edited
+class HitTesterTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    //a link connected to a dragged block is deleted mid-drag: neither the
+    //HitTester nor the BSP index of the scene may find it at its old place
+    void removeLinkMidDrag();
+};
+
+void HitTesterTest::removeLinkMidDrag()
+{
+    Scene scene;
+    auto prototype = BlockPrototype::get("FIR",{{Block::PortDir::Input,"Double","In"},
+                                                {Block::PortDir::Output,"Double","Out"}});
+    auto block = new Block(prototype,"fir");
+    scene.addItem(block);
+    const auto &connector = prototype->getConnector(block->getBlockOrientation(),1);
+    auto port = block->isMouseOverPort(connector.hitRect.center());
+    QVERIFY(port != nullptr);
+
+    const QPointF anchor = block->getPortConnectionPoint(*port);
+    auto link = new Link(anchor);
+    link->insertLineAt(anchor,anchor+QPointF(400.0,0.0),Link::LinkPath::straight);
+    link->connectLinkToPortAtLastInsertedLine(port,true);
+    scene.addItem(link);
+    QVERIFY(port->isConnected());
+
+    //the drag moves the block and the connected end of the link, as
+    //Block::mouseMoveEvent()
+    auto drag = [&](const QPointF &pos)
+    {
+        block->setPos(pos);
+        if( port->isConnected() )
+        {
+            LinkEditScope edit(port->connectionLink.link);
+            port->connectionLink.link->moveSelectedNode(port->connectionLink.nodeIdx,
+                                                        block->getPortConnectionPoint(*port));
+        }
+    };
+    for( int step=1 ; step<=4 ; step++ )
+        drag(QPointF(0.0,20.0*step));
+    QVERIFY(!link->getLines().isEmpty());
+    const QPointF oldPos = link->getLines().front().pointAt(0.5);
+    QVERIFY(scene.getHitTester().linksAt(oldPos,false).size() == 1);
+    QVERIFY(scene.getHitTester().itemAt(oldPos,false).link == link);
+
+    scene.removeItem(link);
+    delete link;
+    QVERIFY(!port->isConnected());
+    QVERIFY(scene.getHitTester().linksAt(oldPos,false).empty());
+    QVERIFY(scene.getHitTester().itemAt(oldPos,false).link == nullptr);
+    for( auto item : scene.items(oldPos) )
+        QVERIFY(item->type() != Link::Type);
+
+    //the rest of the drag does not touch the deleted link
+    drag(QPointF(0.0,100.0));
+    QVERIFY(scene.getHitTester().itemAt(oldPos,false).link == nullptr);
+}
+
+QTEST_MAIN(HitTesterTest)
+
+#include "tst_hittester.moc"
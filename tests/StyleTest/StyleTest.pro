@@ -0,0 +1,11 @@
+QT       += core gui widgets testlib
+
+CONFIG += c++17 testcase
+CONFIG -= app_bundle
+
+TARGET = tst_style
+
+include(../../GuiBlocks/GuiBlocks.pri)
+
+SOURCES += \
+    tst_style.cpp
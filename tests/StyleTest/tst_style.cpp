@@ -0,0 +1,53 @@
+#include <QtTest>
+#include "GuiBlocks/Block.h"
+#include "GuiBlocks/BlockPrototype.h"
+#include "GuiBlocks/Style.h"
+#include "GuiBlocks/TextCache.h"
+
+using namespace GuiBlocks;
+
+//The caches built from the Style (see Style::changed()) are built again
+//after a Style setter
+class StyleTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void setFontRebuildsCaches();
+};
+
+void StyleTest::setFontRebuildsCaches()
+{
+    const QFont original = StyleText::font(StyleText::TypeFont);
+    const QString type = "LowPassFilterBank";
+    const std::vector<Block::PortSignature> ports = {{Block::PortDir::Input,"Double","In"},
+                                                     {Block::PortDir::Output,"Double","Out"}};
+    TextCache cache;
+    const double advance = cache.text(type,StyleText::TypeFont).advance;
+    const double metricsAdvance = TextCache::metrics(StyleText::TypeFont).horizontalAdvance(type);
+    auto prototype = BlockPrototype::get(type,ports);
+    QVERIFY(BlockPrototype::get(type,ports) == prototype);
+    Block block(prototype,"filter");
+
+    QFont bigger = original;
+    bigger.setPointSizeF(original.pointSizeF()*2.0);
+    StyleText::setFont(StyleText::TypeFont,bigger);
+
+    //the text, the metrics and the prototype are laid out with the new font
+    QVERIFY(cache.text(type,StyleText::TypeFont).advance > advance);
+    QVERIFY(TextCache::metrics(StyleText::TypeFont).horizontalAdvance(type) > metricsAdvance);
+    auto rebuilt = BlockPrototype::get(type,ports);
+    QVERIFY(rebuilt != prototype);
+    QVERIFY(rebuilt->getBlockRect().width() > prototype->getBlockRect().width());
+    //the blocks keep their prototype until they are laid out again
+    QVERIFY(block.getPrototype() == prototype);
+    block.layout();
+    QVERIFY(block.getPrototype() == rebuilt);
+
+    StyleText::setFont(StyleText::TypeFont,original);
+    QVERIFY(cache.text(type,StyleText::TypeFont).advance == advance);
+}
+
+QTEST_MAIN(StyleTest)
+
+#include "tst_style.moc"